@@ -14,157 +14,266 @@
 #include <QPixmap>
 #include <QImage>
 #include <complex>
+#include <cstring>
 #include <qmath.h>
 #include <fftw3.h>
 #include "analytic_scope.hpp"
 
-AnalyticScope::AnalyticScope(QWidget * parent) : RasterImage(parent)
+template<typename Real>
+AnalyticScopeT<Real>::AnalyticScopeT(QWidget * parent) : RasterImage(parent)
 {
-    fftw_init_threads();
-    fftw_plan_with_nthreads(4);
-    in   = (std::complex<double> *) fftw_alloc_complex(FRAME_SIZE);
-    pre = (double *) fftw_alloc_real(FRAME_SIZE);
-    inPlan = fftw_plan_dft_r2c_1d(FRAME_SIZE,
-                                  pre,
-                                  reinterpret_cast<fftw_complex*>(in), FFTW_MEASURE);
-    outPlan = fftw_plan_dft_1d(FRAME_SIZE,  reinterpret_cast<fftw_complex*>(in),
-                               reinterpret_cast<fftw_complex*>(in), FFTW_BACKWARD, FFTW_MEASURE);
+}
 
+template<typename Real>
+AnalyticScopeT<Real>::~AnalyticScopeT()
+{
+    quit();
+    freeStreams();
 }
 
-void AnalyticScope::fft_dyn_alloc() {
-    
+template<typename Real>
+void AnalyticScopeT<Real>::freeStreams()
+{
+    for(Stream * s : m_streams)
+        delete s;
+    m_streams.clear();
 }
 
-AnalyticScope::~AnalyticScope()
+// triggers keep len() long windows; new ones are made on the next frame
+template<typename Real>
+void AnalyticScopeT<Real>::postFormat()
 {
-    fftw_free(in);
+    freeStreams();
 }
 
-void AnalyticScope::refreshImpl()
+// Input from before the start doesn't join up with what follows, so each
+// stream fills its window afresh. The reset drops a held single shot's
+// window, so the trigger is let fire again too. The phosphor holds still
+// while stopped rather than decaying by the whole pause at once.
+template<typename Real>
+void AnalyticScopeT<Real>::postStart()
 {
-    int x, y;
-    int N = qMin((quint32) FRAME_SIZE, len());
-    
-    for(int32_t n = 0; n < N ; n++) {
-        pre[n] = (double) data()[n] / 32768.0;
+    for(Stream * s : m_streams) {
+        s->primed = false;
+        s->trigger.rearm();
     }
-    
-    fftw_execute(inPlan);
- 
-    for(int32_t n = N/2+1; n < FRAME_SIZE ; n++) {
-        in[n] = 0.0;
+    m_lastFrame = 0;
+}
+
+template<typename Real>
+void AnalyticScopeT<Real>::applyParams()
+{
+    const quint32 rearms = m_params.rearms;
+    if(!m_paramBox.fetch(m_params))
+        return;
+    // a new kernel starts from silence, so refill the window
+    for(Stream * s : m_streams) {
+        const int taps = s->filter.taps();
+        s->filter.setTaps(m_params.taps);
+        if(s->filter.taps() != taps)
+            s->primed = false;
+        s->trigger.setSettings(triggerSettings());
+        if(m_params.rearms != rearms)
+            s->trigger.rearm();
     }
-    
-    fftw_execute(outPlan);
-    
-    for(int32_t n = 0; n < N ; n++) {
-        in[n] /= (double) N / m_scale;
+}
+
+// The trigger sees the filter's output before trace() scales it, so the
+// level and hysteresis are divided by the same gain.
+template<typename Real>
+typename Trigger<Real>::Settings AnalyticScopeT<Real>::triggerSettings() const
+{
+    const Params & p = m_params;
+    const qreal gain = p.scale / 2;
+    typename Trigger<Real>::Settings s;
+    s.edge = p.triggerEdge;
+    s.mode = p.triggerMode;
+    s.level = (Real) (p.trigger_level / gain);
+    s.hysteresis = (Real) (p.hysteresis / gain);
+    s.holdoff = (quint32) qRound(p.holdoff * sampleRate());
+    s.pretrigger = (quint32) (p.pretrigger * len());
+    return s;
+}
+
+// One channel's analytic signal into its trigger. Only the hop() samples
+// new since the last frame go through the filter; the first frame after
+// a (re)start fills the whole window.
+template<typename Real>
+void AnalyticScopeT<Real>::analyze(int channel, const scope_real * samples)
+{
+    while(m_streams.size() <= channel) {
+        Stream * s = new Stream;
+        s->filter.setTaps(m_params.taps);
+        s->trigger.setLength(len());
+        s->trigger.setSettings(triggerSettings());
+        m_streams.append(s);
+    }
+    Stream * s = m_streams[channel];
+    const quint32 N = len();
+    const quint32 fresh = s->primed ? qMin(hop(), N) : N;
+    if(!s->primed) {
+        s->filter.reset();
+        s->trigger.reset();
     }
+    s->primed = true;
+    stage(StageClock::Setup);
 
-    int trigger_offset = -1;
-    std::complex<double> trigger_z;
-    
-    int m_maxX = width();
-    int m_maxY = height();
-    int maxSq = qMin(m_maxX, m_maxY);
+    m_fresh.resize(N);
+    s->filter.process(samples + N - fresh, fresh, m_fresh.data());
+    stage(StageClock::FFT);
+    s->trigger.push(m_fresh.constData(), fresh);
+    stage(StageClock::Trigger);
+}
+
+// Plots a window centred in `cell`, turned so the trigger sample lies on
+// the real axis; a free-running window is plotted as it is.
+template<typename Real>
+void AnalyticScopeT<Real>::trace(const QRect & cell, const std::complex<Real> * in, int triggerIndex)
+{
+    int x, y;
+    int N = len();
+    // half scale matches the amplitude of the old one-sided FFT
+    const Real gain = (Real) (m_params.scale / 2);
+    std::complex<Real> trigger_z = gain;
+    if(triggerIndex >= 0 && abs(in[triggerIndex]) > 0)
+        trigger_z = conj(in[triggerIndex]) / abs(in[triggerIndex]) * gain;
     
-    double val[3][m_maxX][m_maxY];
+    int maxSq = qMin(cell.width(), cell.height());
+    int centerX = cell.x() + cell.width()/2;
+    int centerY = cell.y() + cell.height()/2;
     
-    memset(val, 0, 3*m_maxX*m_maxY*sizeof(double));
+    const Params & p = m_params;
     
-    for(int32_t n = 1; n < N ; n++) {
-        if(trigger_offset < 0 && real(in[n]) >= trigger_level && real(in[n-1]) < trigger_level) {
-            trigger_offset = n;
-            trigger_z = conj(in[n]) / abs(in[n]);
-            n = 0;
-        }
-        if(trigger_offset < 0)
-            continue;
-        y = qFloor(real(in[n]*trigger_z)*maxSq + m_maxY/2);
-        x = qFloor(imag(in[n]*trigger_z)*maxSq + m_maxX/2);
+    for(int32_t n = 0; n < N ; n++) {
+        y = qFloor(real(in[n]*trigger_z)*maxSq + centerY);
+        x = qFloor(imag(in[n]*trigger_z)*maxSq + centerX);
         
-        if(x >= 0 && x < m_maxX && y >= 0 && y < m_maxY) {
-            double incr = (qreal) ((n - trigger_offset) % N) / (qreal) N;
-            val[1][x][y] = 1.0;
-            val[0][x][y] = incr*m_redDecay;
-            val[2][x][y] = incr*m_blueDecay;
-            int M = 256/m_greenDecay;
-            for(int x2 = qMax(0,x-M); x2 < qMin(m_maxX, x+M+1); x2++) {
-                if(x!=x2) {
-                    val[2][x2][y] = qMax(0.0,  (incr*m_redDecay) - abs(x-x2)*m_greenDecay/256.0);
-                }
-                
-            }
-            for(int y2 = qMax(0,y-M); y2 < qMin(m_maxY, y+M+1); y2++) {
-                if(y!=y2) {
-                    val[0][x][y2] = qMax(0.0,  (incr*m_blueDecay) - abs(y-y2)*m_greenDecay/256.0);
-                }
-            }
+        if(x >= cell.left() && x <= cell.right() && y >= cell.top() && y <= cell.bottom()) {
+            double incr = (qreal) n / (qreal) N;
+            m_raster.add(x, y, qRound(incr*p.redDecay*255.0), qRound(incr*p.blueDecay*255.0));
         }
     }
-    QPainter imgPainter(this);
-    QColor color;
-    color.setRgbF(0.0, 0.0, 0.0);
-    color.setAlphaF(.05);
-    imgPainter.setBrush(color);
-    imgPainter.setPen(Qt::NoPen);
-    imgPainter.drawRect(0,0,width(), height());
-    for(qint32 r = 0; r < m_maxX; r++) {
-        for (qint32 c = 0; c < m_maxY; c++) {
-            if(val[0][r][c] > 0 && val[1][r][c] > 0 &&val[2][r][c] > 0) {
-                color.setRedF(val[0][r][c]);
-                color.setGreenF(val[1][r][c]);
-                color.setBlueF(val[2][r][c]);
-                setPixelColor(r, c, color);
-            }
-        }
+    stage(StageClock::Raster);
+}
+
+template<typename Real>
+void AnalyticScopeT<Real>::refreshImpl()
+{
+    const Params & p = m_params;
+    
+    // per channel, the image is split into a near-square grid of cells
+    const int cells = p.perChannel ? channels() : 1;
+    const int cols = qCeil(qSqrt(cells));
+    const int rows = (cells + cols - 1) / cols;
+    
+    m_raster.resize(width(), height());
+    m_phosphor.resize(width(), height());
+    m_raster.begin();
+    for(int c = 0; c < cells; c++) {
+        analyze(c, data(c));
+        // nothing is drawn until a trigger's window is in, unless free-running
+        Trigger<Real> & trigger = m_streams[c]->trigger;
+        const std::complex<Real> * window = trigger.window();
+        if(window != NULL)
+            trace(QRect(c % cols * width() / cols, c / cols * height() / rows,
+                        width() / cols, height() / rows),
+                  window, trigger.triggerIndex());
     }
+    
+    // Persistence decays with scope time: wall-clock time live, the
+    // input's own time offline so renders don't depend on speed.
+    const qint64 now = ScopeStats::now();
+    qreal dt = (qreal) hop() / sampleRate();
+    if(!offline())
+        dt = m_lastFrame == 0 ? 0 : (now - m_lastFrame) * 1e-9;
+    m_lastFrame = now;
+    m_phosphor.decay(dt, p.halfLife);
+
+    const int arm = 256/p.greenDecay;
+    float * planes[3] = {m_phosphor.plane(0), m_phosphor.plane(1), m_phosphor.plane(2)};
+    m_raster.accumulate(planes, m_phosphor.stride(), PHOSPHOR_MAX, arm, p.greenDecay);
+    setDirty(m_phosphor.present(*this, m_raster.bounds(arm)));
+    stage(StageClock::Raster);
 }
 
 
 
-void AnalyticScope::wheelEvent(QWheelEvent *ev)
+template<typename Real>
+void AnalyticScopeT<Real>::wheelEvent(QWheelEvent *ev)
 {
     if((ev->angleDelta().x() != 0 || ev->angleDelta().y() != 0)) {
         
-        if(QApplication::queryKeyboardModifiers().testFlag(Qt::ShiftModifier)) {
+        if(QApplication::queryKeyboardModifiers().testFlag(Qt::ControlModifier) &&
+           QApplication::queryKeyboardModifiers().testFlag(Qt::ShiftModifier)) {
+            if(ev->angleDelta().y() > 0)
+                m_ui.hysteresis *= 1.1;
+            else if(ev->angleDelta().y() < 0)
+                m_ui.hysteresis /= 1.1;
+            m_ui.hysteresis = qBound(0.001, m_ui.hysteresis, 1.0);
+            
+            setTitle(QString("[Hysteresis: %1]").arg(m_ui.hysteresis));
+        } else if(QApplication::queryKeyboardModifiers().testFlag(Qt::ShiftModifier)) {
             
             if(ev->angleDelta().x() > 0)
-                m_greenDecay += 4;
+                m_ui.greenDecay += 4;
             else if(ev->angleDelta().x() < 0)
-                m_greenDecay -= 4;
-            m_greenDecay = qMax(1, qMin(128, m_greenDecay));
+                m_ui.greenDecay -= 4;
+            m_ui.greenDecay = qMax(1, qMin(128, m_ui.greenDecay));
             
             if(ev->angleDelta().y() > 0) // up Wheel
-                m_scale *= 1.05;
+                m_ui.scale *= 1.05;
             else if(ev->angleDelta().y() < 0) //down Wheel
-                m_scale /= 1.05;
-            m_scale = qMax(0.001, m_scale);
-            QApplication::activeWindow()->setWindowTitle(QString("[Scale: %1] [Green: %2]").arg( m_scale).arg(m_greenDecay));
+                m_ui.scale /= 1.05;
+            m_ui.scale = qMax(0.001, m_ui.scale);
+            setTitle(QString("[Scale: %1] [Green: %2]").arg( m_ui.scale).arg(m_ui.greenDecay));
+        } else if(QApplication::queryKeyboardModifiers().testFlag(Qt::ControlModifier)) {
+            if(ev->angleDelta().y() > 0)
+                m_ui.halfLife *= 1.1;
+            else if(ev->angleDelta().y() < 0)
+                m_ui.halfLife /= 1.1;
+            m_ui.halfLife = qBound(0.02, m_ui.halfLife, 10.0);
+            
+            if(ev->angleDelta().x() > 0)
+                m_ui.holdoff += .001;
+            else if(ev->angleDelta().x() < 0)
+                m_ui.holdoff -= .001;
+            m_ui.holdoff = qBound(0.0, m_ui.holdoff, 1.0);
+            
+            setTitle(QString("[Half-life: %1 ms] [Holdoff: %2 ms]")
+                     .arg(qRound(m_ui.halfLife * 1000)).arg(qRound(m_ui.holdoff * 1000)));
         } else if(
                   QApplication::queryKeyboardModifiers().testFlag(Qt::AltModifier)) {
             if(ev->angleDelta().x() > 0)
-                m_blueDecay += .01;
+                m_ui.blueDecay += .01;
             else if(ev->angleDelta().x() < 0)
-                m_blueDecay -= .01;
-            m_blueDecay = qMax(0.001, qMin(1.0, m_blueDecay));
+                m_ui.blueDecay -= .01;
+            m_ui.blueDecay = qMax(0.001, qMin(1.0, m_ui.blueDecay));
             
             if(ev->angleDelta().y() > 0)
-                m_redDecay += .01;
+                m_ui.redDecay += .01;
             else if(ev->angleDelta().y() < 0)
-                m_redDecay -= .01;
-            m_redDecay = qMax(0.001, qMin(1.0, m_redDecay));
+                m_ui.redDecay -= .01;
+            m_ui.redDecay = qMax(0.001, qMin(1.0, m_ui.redDecay));
             
-            QApplication::activeWindow()->setWindowTitle(QString("[Red: %1] [Blue: %2]").arg( m_redDecay).arg(m_blueDecay));
+            setTitle(QString("[Red: %1] [Blue: %2]").arg( m_ui.redDecay).arg(m_ui.blueDecay));
         } else {
             if(ev->angleDelta().y() > 0.0)
-                trigger_level += .01;
+                m_ui.trigger_level += .01;
             else if(ev->angleDelta().y() < 0.0)
-                trigger_level -= .01;
+                m_ui.trigger_level -= .01;
             
-            QApplication::activeWindow()->setWindowTitle(QString("[Trigger: %1]").arg( trigger_level));
+            if(ev->angleDelta().x() > 0.0)
+                m_ui.pretrigger += .05;
+            else if(ev->angleDelta().x() < 0.0)
+                m_ui.pretrigger -= .05;
+            m_ui.pretrigger = qBound(0.0, m_ui.pretrigger, 0.9);
+            
+            setTitle(QString("[Trigger: %1] [Pre-trigger: %2%]")
+                     .arg( m_ui.trigger_level).arg(qRound(m_ui.pretrigger * 100)));
             
         }
+        m_paramBox.post(m_ui);
     }
 }
+
+template class AnalyticScopeT<scope_real>;
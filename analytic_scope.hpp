@@ -9,37 +9,104 @@
 #define hilbert_scatter_view_hpp
 
 #include "raster_image.hpp"
+#include "point_raster.hpp"
+#include "phosphor.hpp"
+#include "hilbert_filter.hpp"
+#include "trigger.hpp"
 #include <complex>
 #include <qmath.h>
-#include <fftw3.h>
+#include "fftw_traits.hpp"
 
 
-
-class AnalyticScope : public RasterImage
+// Real picks the DSP precision (float or double), see fftw_traits.hpp.
+template<typename Real>
+class AnalyticScopeT : public RasterImage
 {
 
 public:
-    explicit AnalyticScope(QWidget *parent);
-    ~AnalyticScope();
+    explicit AnalyticScopeT(QWidget *parent);
+    ~AnalyticScopeT();
+    // as long as the phosphor takes to go dark
+    quint32 historyFrames() const override {
+        return qCeil(Phosphor::fadeTime(m_params.halfLife) * sampleRate() / hop());
+    }
+    
+    // GUI side: analyze every captured channel in its own cell, rather
+    // than just the first
+    void setPerChannel(bool on) {
+        m_ui.perChannel = on;
+        m_paramBox.post(m_ui);
+    }
+    // GUI side: length of the FIR Hilbert transformer; longer is flatter
+    // at low frequencies, at (taps-1)/2 samples of delay
+    void setHilbertTaps(int taps) {
+        m_ui.taps = taps;
+        m_paramBox.post(m_ui);
+    }
+    // GUI side: see Trigger
+    void setTriggerEdge(int edge) {
+        m_ui.triggerEdge = edge;
+        m_paramBox.post(m_ui);
+    }
+    void setTriggerMode(int mode) {
+        m_ui.triggerMode = mode;
+        m_paramBox.post(m_ui);
+    }
+    // lets a single shot fire again
+    void rearmTrigger() {
+        m_ui.rearms++;
+        m_paramBox.post(m_ui);
+    }
 
     
 protected:
     void wheelEvent(QWheelEvent *ev) override;
     void refreshImpl() override;
+    void applyParams() override;
+    void postFormat() override;
+    void postStart() override;
 private:
+    struct Params {
+        qreal scale = 1.0;
+        qreal redDecay = .6667;
+        qreal blueDecay = .75;
+        int greenDecay = 4;
+        qreal trigger_level = 0.0;
+        qreal hysteresis = 0.02;
+        qreal holdoff = 0.0;        // seconds
+        qreal pretrigger = 0.0;     // of the window
+        int triggerEdge = Trigger<Real>::Rising;
+        int triggerMode = Trigger<Real>::Normal;
+        quint32 rearms = 0;
+        bool perChannel = false;
+        qreal halfLife = 0.5;       // of the phosphor, seconds
+        int taps = HILBERT_TAPS;
+    };
+    Params m_ui;        // edited on the GUI thread
+    Params m_params;    // in effect on the worker
+    Mailbox<Params> m_paramBox;
+
     qreal m_level = 0;
-    qreal m_scale = 1.0;
-    qreal m_redDecay = .6667;
-    qreal m_blueDecay = .75;
-    int m_greenDecay = 4;
-    
     int m_doRefresh = 0;
-    std::complex<double> *in;
-    double *pre;
-    fftw_plan inPlan, outPlan;
+    PointRaster m_raster;
+    Phosphor m_phosphor;
+    qint64 m_lastFrame = 0;     // ScopeStats::now() of the last refresh
+    // Each channel's analytic signal streams through its own filter into
+    // its own trigger, which keeps the last few frames of it.
+    struct Stream {
+        HilbertFilter<Real> filter;
+        Trigger<Real> trigger;
+        bool primed = false;
+    };
+    QVector<Stream *> m_streams;
+    QVector<std::complex<Real> > m_fresh;   // filter output on its way to a trigger
+    void freeStreams();
+    typename Trigger<Real>::Settings triggerSettings() const;
     
-    qreal trigger_level = 0.0;
-    void fft_dyn_alloc();
+    void analyze(int channel, const scope_real * samples);
+    void trace(const QRect & cell, const std::complex<Real> * in, int triggerIndex);
 };
 
+typedef AnalyticScopeT<scope_real> AnalyticScope;
+
 #endif /* hilbert_scatter_view_hpp */
@@ -0,0 +1,133 @@
+//
+//  bench_main.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QScopedPointer>
+#include <QVector>
+#include <QtEndian>
+#include <cstdio>
+#include <cmath>
+#include "analytic_scope.hpp"
+#include "spectrum_scope.hpp"
+
+// frames rendered and thrown away before timing starts, so planning and
+// first-frame work (SpectrumScope's full 2D FFT) stay out of the numbers
+#define BENCH_WARMUP_FRAMES 16
+
+// Mono PCM in `format`'s encoding (s16 or f32), as capture would hand it
+// over, so the bench times ingest() as well as the scope.
+static QByteArray makeSignal(const QString & kind, int len, const SampleFormat & format)
+{
+    QByteArray s(len * format.bytesPerFrame(), Qt::Uninitialized);
+    quint32 lcg = 1;
+    for(int n = 0; n < len; n++) {
+        const double t = (double) n / DEFAULT_SAMPLE_RATE;
+        double v = 0;
+        if(kind == "sine") {
+            v = 0.5 * sin(2*M_PI*1000.0*t);
+        } else if(kind == "chirp") {
+            // 20 Hz to 20 kHz over the whole signal
+            const double T = (double) len / DEFAULT_SAMPLE_RATE;
+            const double k = log(20000.0/20.0) / T;
+            v = 0.5 * sin(2*M_PI*20.0*(exp(k*t) - 1.0)/k);
+        } else if(kind == "noise") {
+            lcg = lcg*1664525u + 1013904223u;
+            v = 0.5 * ((double) (lcg >> 8) / (1 << 24) * 2.0 - 1.0);
+        }
+        if(format.encoding == SampleFormat::F32)
+            qToLittleEndian<float>((float) v, s.data() + n*4);
+        else
+            qToLittleEndian<qint16>((qint16) qRound(v * 32767), s.data() + n*2);
+    }
+    return s;
+}
+
+static RasterImage * makeScope(const QString & name)
+{
+    if(name == "spectrum")
+        return new SpectrumScope(nullptr);
+    return new AnalyticScope(nullptr);
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times ingest() and each scope's refreshImpl() on synthetic input.");
+    parser.addHelpOption();
+    QCommandLineOption framesOption("frames", "Frames timed per case.", "n", "256");
+    QCommandLineOption scopesOption("scopes", "Comma separated scopes.", "list", "analytic,spectrum");
+    QCommandLineOption signalsOption("signals", "Comma separated signals.", "list", "sine,chirp,noise,silence");
+    QCommandLineOption sizesOption("sizes", "Comma separated WxH sizes.", "list",
+                                   "400x400,800x800,1920x1080,3840x2160");
+    QCommandLineOption encodingOption("encoding", "Input PCM, s16 or f32.", "name", "s16");
+    parser.addOption(framesOption);
+    parser.addOption(scopesOption);
+    parser.addOption(signalsOption);
+    parser.addOption(sizesOption);
+    parser.addOption(encodingOption);
+    parser.process(app.arguments());
+
+    const int frames = qMax(1, parser.value(framesOption).toInt());
+    const quint32 hop = BASE_FRAME_SIZE / 2;
+    const int total = BENCH_WARMUP_FRAMES + frames;
+    SampleFormat format;
+    format.encoding = parser.value(encodingOption) == "f32" ? SampleFormat::F32 : SampleFormat::S16;
+
+    fftwInit();
+
+    printf("%-9s %-8s %-10s %12s %10s", "scope", "signal", "size", "ns/frame", "frames/s");
+    for(int s = 0; s < StageClock::Count; s++)
+        printf(" %10s", StageClock::name(s));
+    printf("\n");
+
+    for(const QString & scopeName : parser.value(scopesOption).split(",")) {
+        for(const QString & signal : parser.value(signalsOption).split(",")) {
+            const QByteArray raw = makeSignal(signal, BASE_FRAME_SIZE + hop*total, format);
+            for(const QString & size : parser.value(sizesOption).split(",")) {
+                QStringList wh = size.split("x");
+                QScopedPointer<RasterImage> scope(makeScope(scopeName));
+                scope->resize(QSize(wh.value(0).toInt(), wh.value(1).toInt()));
+
+                // each frame ingests the hop it adds, the first its whole window
+                QVector<scope_real> input(BASE_FRAME_SIZE + hop*total);
+                StageClock clock;
+                auto frame = [&](int f) {
+                    const quint32 from = f == 0 ? 0 : BASE_FRAME_SIZE + (f-1)*hop;
+                    const quint32 to = BASE_FRAME_SIZE + f*hop;
+                    QElapsedTimer t;
+                    t.start();
+                    ingest(raw.constData() + from*format.bytesPerFrame(), to - from, format, input.data() + from);
+                    clock.add(StageClock::Ingest, t.nsecsElapsed());
+                    scope->render(input.constData() + f*hop);
+                };
+                for(int f = 0; f < BENCH_WARMUP_FRAMES; f++)
+                    frame(f);
+
+                clock.reset();
+                scope->setStageClock(&clock);
+                QElapsedTimer timer;
+                timer.start();
+                for(int f = BENCH_WARMUP_FRAMES; f < total; f++)
+                    frame(f);
+                const qint64 ns = timer.nsecsElapsed();
+
+                printf("%-9s %-8s %-10s %12.0f %10.1f", qPrintable(scopeName), qPrintable(signal),
+                       qPrintable(size), (double) ns / frames, frames * 1e9 / ns);
+                for(int s = 0; s < StageClock::Count; s++)
+                    printf(" %10.0f", (double) clock.ns(s) / frames);
+                printf("\n");
+                fflush(stdout);
+            }
+        }
+    }
+    fftwSaveWisdom();
+    fftwCleanup();
+    return 0;
+}
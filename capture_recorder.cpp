@@ -0,0 +1,316 @@
+//
+//  capture_recorder.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <QtEndian>
+#include <QDateTime>
+#include <QDir>
+#include <algorithm>
+#include <cstring>
+#include "capture_recorder.hpp"
+
+// of the history and the write block; a page, so unbuffered writes go
+// straight from it
+#define CAPTURE_ALIGN 4096
+#define WAV_HEADER_BYTES 44
+
+namespace {
+
+// The canonical header PcmFile reads back: plain PCM or IEEE float, no
+// extensible format chunk.
+void wavHeader(char * h, const SampleFormat & f, quint32 dataBytes)
+{
+    memcpy(h, "RIFF", 4);
+    qToLittleEndian<quint32>(36 + dataBytes, h + 4);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    qToLittleEndian<quint32>(16, h + 16);
+    // 1 is integer PCM, 3 IEEE float
+    qToLittleEndian<quint16>(f.encoding == SampleFormat::F32 ? 3 : 1, h + 20);
+    qToLittleEndian<quint16>(f.channels, h + 22);
+    qToLittleEndian<quint32>(f.rate, h + 24);
+    qToLittleEndian<quint32>(f.rate * f.bytesPerFrame(), h + 28);
+    qToLittleEndian<quint16>(f.bytesPerFrame(), h + 32);
+    qToLittleEndian<quint16>(f.bytesPerSample() * 8, h + 34);
+    memcpy(h + 36, "data", 4);
+    qToLittleEndian<quint32>(dataBytes, h + 40);
+}
+
+void swapBytes(char * p, quint32 samples, int width)
+{
+    for(quint32 i = 0; i < samples; i++, p += width)
+        std::reverse(p, p + width);
+}
+
+} // namespace
+
+void CaptureWriter::run()
+{
+    m_recorder->run();
+}
+
+CaptureRecorder::CaptureRecorder() : m_writer(this), m_trigger(CAPTURE_SCAN_FRAMES)
+{
+    m_head.storeRelaxed(0);
+    m_dropped.storeRelaxed(0);
+    m_snapshotAt.storeRelaxed(0);
+    m_snapshots.storeRelaxed(0);
+    m_quit.storeRelaxed(0);
+    m_block = (char *) qMallocAligned(CAPTURE_WRITE_BYTES, CAPTURE_ALIGN);
+}
+
+CaptureRecorder::~CaptureRecorder()
+{
+    quit();
+    qFreeAligned(m_buf);
+    qFreeAligned(m_block);
+}
+
+void CaptureRecorder::quit()
+{
+    if(!m_writer.isRunning())
+        return;
+    m_quit.storeRelease(1);
+    m_wake.release();
+    m_writer.wait();
+}
+
+void CaptureRecorder::setFormat(const SampleFormat & format, qreal seconds)
+{
+    quit();
+    m_format = format;
+    m_frameBytes = format.bytesPerFrame();
+    const qint64 frames = (qint64) (seconds * format.rate) + CAPTURE_GUARD_FRAMES;
+    m_capacity = 1;
+    while(m_capacity < frames)
+        m_capacity *= 2;
+    qFreeAligned(m_buf);
+    m_buf = (char *) qMallocAligned(m_capacity * m_frameBytes, CAPTURE_ALIGN);
+    m_head.storeRelaxed(0);
+    m_snapshotsSeen = m_snapshots.loadRelaxed();
+
+    m_raw.resize(CAPTURE_SCAN_FRAMES * m_frameBytes);
+    m_ingest.resize(CAPTURE_SCAN_FRAMES * format.channels);
+    m_channel0.resize(CAPTURE_SCAN_FRAMES);
+    // the writer takes the params up again from scratch, so triggering
+    // restarts and a recording goes on in a new file
+    m_params = Params();
+    m_paramBox.post(m_ui);
+
+    m_quit.storeRelaxed(0);
+    m_writer.start();
+}
+
+void CaptureRecorder::setParams(const Params & params)
+{
+    m_ui = params;
+    m_paramBox.post(m_ui);
+    m_wake.release();
+}
+
+void CaptureRecorder::snapshot()
+{
+    m_snapshotAt.storeRelaxed(m_head.loadAcquire());
+    m_snapshots.fetchAndAddRelease(1);
+    m_wake.release();
+}
+
+// Steps of at most CAPTURE_GUARD_FRAMES, each published before the next
+// one starts, bound how far ahead of the head the producer can be
+// overwriting.
+void CaptureRecorder::write(const char * bytes, quint32 len)
+{
+    if(m_buf == NULL)
+        return;
+    quint64 head = m_head.loadRelaxed();
+    while(len > 0) {
+        const quint32 n = qMin(len, (quint32) CAPTURE_GUARD_FRAMES);
+        const qint64 i = head & (m_capacity - 1);
+        const qint64 first = qMin((qint64) n, m_capacity - i);
+        memcpy(m_buf + i * m_frameBytes, bytes, first * m_frameBytes);
+        memcpy(m_buf, bytes + first * m_frameBytes, (n - first) * m_frameBytes);
+        head += n;
+        m_head.storeRelease(head);
+        bytes += (size_t) n * m_frameBytes;
+        len -= n;
+    }
+    m_wake.release();
+}
+
+void CaptureRecorder::copyOut(qint64 from, quint32 len, char * dst) const
+{
+    const qint64 i = from & (m_capacity - 1);
+    const qint64 first = qMin((qint64) len, m_capacity - i);
+    memcpy(dst, m_buf + i * m_frameBytes, first * m_frameBytes);
+    memcpy(dst + first * m_frameBytes, m_buf, (len - first) * m_frameBytes);
+}
+
+// Wakes on every block the producer adds, and at least every
+// CAPTURE_POLL_MS for the GUI's requests.
+void CaptureRecorder::run()
+{
+    while(!m_quit.loadAcquire()) {
+        m_wake.tryAcquire(qMax(1, m_wake.available()), CAPTURE_POLL_MS);
+        step();
+    }
+    if(m_next >= 0) {
+        drain(m_head.loadAcquire());
+        if(m_next >= 0)
+            close();
+    }
+}
+
+void CaptureRecorder::step()
+{
+    const qint64 head = m_head.loadAcquire();
+    const qint64 oldest = qMax((qint64) 0, head + CAPTURE_GUARD_FRAMES - m_capacity);
+    Params p;
+    if(m_paramBox.fetch(p))
+        applyParams(p, head);
+
+    const int snapshots = m_snapshots.loadAcquire();
+    if(snapshots != m_snapshotsSeen) {
+        m_snapshotsSeen = snapshots;
+        const qint64 at = m_snapshotAt.loadRelaxed();
+        if(m_next < 0)
+            open(at - frames(m_params.pre), at + frames(m_params.post), oldest);
+    }
+    if(m_params.onTrigger)
+        scan(head, oldest);
+    if(m_params.recording) {
+        if(m_next < 0 && !open(head, -1, oldest))
+            m_params.recording = false;
+    } else if(m_next >= 0 && m_end < 0) {
+        m_end = head;
+    }
+    if(m_next >= 0)
+        drain(head);
+}
+
+void CaptureRecorder::applyParams(const Params & params, qint64 head)
+{
+    if(params.onTrigger && !m_params.onTrigger) {
+        m_scanned = m_triggerBase = head;
+        m_trigger.reset();
+    }
+    m_params = params;
+    Trigger<scope_real>::Settings s;
+    s.edge = params.edge;
+    s.level = (scope_real) params.level;
+    s.hysteresis = (scope_real) params.hysteresis;
+    // one file per event
+    s.holdoff = (quint32) frames(params.post);
+    m_trigger.setSettings(s);
+}
+
+// Converts channel 0 of what arrived since the last pass and feeds it to
+// the trigger. Each trigger found while no file is open starts one. A
+// block the producer lapped while it was being copied is skipped, and
+// the trigger starts over after it, as drain() does for files.
+void CaptureRecorder::scan(qint64 head, qint64 oldest)
+{
+    if(m_scanned < oldest) {
+        m_scanned = m_triggerBase = oldest;
+        m_trigger.reset();
+    }
+    const int channels = m_format.channels;
+    while(m_scanned < head) {
+        const quint32 n = (quint32) qMin(head - m_scanned, (qint64) CAPTURE_SCAN_FRAMES);
+        copyOut(m_scanned, n, m_raw.data());
+        const qint64 safe = (qint64) m_head.loadAcquire() + CAPTURE_GUARD_FRAMES - m_capacity;
+        if(m_scanned < safe) {
+            m_scanned = m_triggerBase = safe;
+            m_trigger.reset();
+            continue;
+        }
+        ingest(m_raw.constData(), n * channels, m_format, m_ingest.data());
+        for(quint32 k = 0; k < n; k++)
+            m_channel0[k] = m_ingest[k * channels];
+        m_trigger.push(m_channel0.constData(), n);
+        m_scanned += n;
+        if(m_trigger.window() != NULL && m_next < 0) {
+            const qint64 t = m_triggerBase + m_trigger.windowStart() + m_trigger.triggerIndex();
+            open(t - frames(m_params.pre), t + frames(m_params.post), oldest);
+        }
+    }
+}
+
+bool CaptureRecorder::open(qint64 from, qint64 to, qint64 oldest)
+{
+    const QString name = QDateTime::currentDateTime().toString("'capture-'yyyyMMdd-hhmmss-zzz'.wav'");
+    m_file.setFileName(m_params.dir.isEmpty() ? name : QDir(m_params.dir).filePath(name));
+    char header[WAV_HEADER_BYTES];
+    wavHeader(header, m_format, 0);
+    if(!m_file.open(QIODevice::WriteOnly | QIODevice::Unbuffered)
+       || m_file.write(header, WAV_HEADER_BYTES) != WAV_HEADER_BYTES) {
+        status(QString("[Capture: %1: %2]").arg(m_file.fileName()).arg(m_file.errorString()));
+        m_file.close();
+        return false;
+    }
+    m_next = qMax(from, oldest);
+    m_end = to;
+    m_fileBytes = 0;
+    m_lost = 0;
+    return true;
+}
+
+// Copies out whole blocks up to `head`, or to the end of the event. A
+// block the producer lapped while it was being copied is lost.
+void CaptureRecorder::drain(qint64 head)
+{
+    const qint64 until = m_end < 0 ? head : qMin(m_end, head);
+    const quint32 blockFrames = CAPTURE_WRITE_BYTES / m_frameBytes;
+    while(m_next < until) {
+        const quint32 n = (quint32) qMin(until - m_next, (qint64) blockFrames);
+        copyOut(m_next, n, m_block);
+        const qint64 safe = (qint64) m_head.loadAcquire() + CAPTURE_GUARD_FRAMES - m_capacity;
+        if(m_next < safe) {
+            const qint64 lost = qMin(safe, until) - m_next;
+            m_lost += lost;
+            m_dropped.fetchAndAddRelaxed(lost);
+            m_next += lost;
+            continue;
+        }
+        const qint64 bytes = (qint64) n * m_frameBytes;
+        if(m_format.bigEndian)
+            swapBytes(m_block, n * m_format.channels, m_format.bytesPerSample());
+        if(m_file.write(m_block, bytes) != bytes) {
+            status(QString("[Capture: %1: %2]").arg(m_file.fileName()).arg(m_file.errorString()));
+            m_params.recording = false;
+            close(false);
+            return;
+        }
+        m_next += n;
+        m_fileBytes += bytes;
+        if(m_end < 0 && m_fileBytes + CAPTURE_WRITE_BYTES > CAPTURE_MAX_FILE_BYTES) {
+            const qint64 next = m_next;
+            close();
+            if(!open(next, -1, 0)) {
+                m_params.recording = false;
+                return;
+            }
+        }
+    }
+    if(m_end >= 0 && m_next >= m_end)
+        close();
+}
+
+// Fills in the header's sizes now they are known.
+void CaptureRecorder::close(bool saved)
+{
+    char header[WAV_HEADER_BYTES];
+    wavHeader(header, m_format, (quint32) m_fileBytes);
+    if(m_file.seek(0))
+        m_file.write(header, WAV_HEADER_BYTES);
+    m_file.close();
+    m_next = -1;
+    if(!saved)
+        return;
+    QString message = QString("[Saved %1: %2 s]").arg(m_file.fileName())
+                      .arg((double) m_fileBytes / m_frameBytes / m_format.rate, 0, 'f', 1);
+    if(m_lost > 0)
+        message += QString(" [Lost: %1 frames]").arg(m_lost);
+    status(message);
+}
@@ -0,0 +1,149 @@
+//
+//  capture_recorder.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef capture_recorder_hpp
+#define capture_recorder_hpp
+
+#include <QThread>
+#include <QFile>
+#include <QSemaphore>
+#include <QString>
+#include <QVector>
+#include <complex>
+#include <functional>
+#include "sample_ingest.hpp"
+#include "triple_buffer.hpp"
+#include "trigger.hpp"
+
+#define CAPTURE_HISTORY_SECONDS 10
+// most frames the producer adds to the history in one step; the writer
+// keeps this far clear of what it may be overwriting
+#define CAPTURE_GUARD_FRAMES 4096
+// frames the writer converts per trigger search
+#define CAPTURE_SCAN_FRAMES 1024
+// bytes per write to a file
+#define CAPTURE_WRITE_BYTES (1 << 20)
+// recordings roll over to a new file past this, well inside a WAV's 4 GB
+#define CAPTURE_MAX_FILE_BYTES 0x7fffffffLL
+#define CAPTURE_POLL_MS 100
+
+class CaptureRecorder;
+
+class CaptureWriter : public QThread {
+public:
+    explicit CaptureWriter(CaptureRecorder * recorder) : m_recorder(recorder) {}
+protected:
+    void run() override;
+private:
+    CaptureRecorder * m_recorder;
+};
+
+// Saves raw capture to WAV files without the capture side ever waiting on
+// the disk. The capture thread only copies each block into a history of
+// the last few seconds and moves on; a writer thread of its own looks
+// for triggers in the history and copies what is worth keeping out to
+// disk in large, unbuffered writes from an aligned block.
+//
+// A file is started by:
+//   snapshot()     `pre` seconds before the call to `post` after
+//   a trigger      the same around an edge on channel 0, when onTrigger
+//   recording      everything from when it is switched on until it is
+//                  off again, in files of up to CAPTURE_MAX_FILE_BYTES
+// One file is written at a time, and events while it is open are
+// ignored. If the writer falls further behind than the history reaches,
+// it skips the frames it lost and counts them in dropped().
+//
+// Files keep the device's encoding, channel count and rate, in
+// little-endian order.
+//
+// Thread ownership:
+//   GUI thread      setFormat(), setParams(), snapshot(), setStatusSink()
+//   capture thread  write()
+//   writer thread   everything else
+class CaptureRecorder {
+public:
+    struct Params {
+        QString dir;                // where files go; "" for the working directory
+        bool onTrigger = false;
+        bool recording = false;
+        int edge = Trigger<scope_real>::Rising;
+        qreal level = 0.5;          // full scale
+        qreal hysteresis = 0.05;
+        qreal pre = 1;              // seconds
+        qreal post = 1;
+    };
+
+    CaptureRecorder();
+    ~CaptureRecorder();
+
+    // GUI side, while no producer is writing: closes any open file and
+    // starts over on an empty history of `seconds` in `format`
+    void setFormat(const SampleFormat & format, qreal seconds = CAPTURE_HISTORY_SECONDS);
+    void setParams(const Params & params);
+    const Params & params() const {return m_ui;}
+    void snapshot();
+    // Called on the writer with each file saved, or what went wrong.
+    void setStatusSink(const std::function<void(const QString &)> & sink) {m_statusSink = sink;}
+
+    // producer side: append `len` frames in the format's wire encoding
+    void write(const char * bytes, quint32 len);
+
+    quint64 dropped() const {return m_dropped.loadRelaxed();}
+
+private:
+    friend class CaptureWriter;
+    CaptureRecorder(const CaptureRecorder &) = delete;
+    CaptureRecorder & operator=(const CaptureRecorder &) = delete;
+
+    void run();
+    void quit();
+    void step();
+    void applyParams(const Params & params, qint64 head);
+    void scan(qint64 head, qint64 oldest);
+    bool open(qint64 from, qint64 to, qint64 oldest);
+    void drain(qint64 head);
+    void close(bool saved = true);
+    void copyOut(qint64 from, quint32 len, char * dst) const;
+    qint64 frames(qreal seconds) const {return (qint64) (seconds * m_format.rate);}
+    void status(const QString & message) {
+        if(m_statusSink)
+            m_statusSink(message);
+    }
+
+    SampleFormat m_format;
+    int m_frameBytes = 0;
+    char * m_buf = NULL;                // history, [capacity] frames
+    qint64 m_capacity = 0;              // a power of two
+    QAtomicInteger<quint64> m_head;     // frames written since setFormat()
+    QAtomicInteger<quint64> m_dropped;
+    QAtomicInteger<quint64> m_snapshotAt;
+    QAtomicInt m_snapshots;
+    QAtomicInt m_quit;
+    QSemaphore m_wake;
+    Params m_ui;
+    Mailbox<Params> m_paramBox;
+    std::function<void(const QString &)> m_statusSink;
+    CaptureWriter m_writer;
+
+    // writer side
+    Params m_params;
+    int m_snapshotsSeen = 0;
+    Trigger<scope_real> m_trigger;
+    qint64 m_scanned = 0;               // frames searched for triggers
+    qint64 m_triggerBase = 0;           // the frame of the trigger's reset()
+    QVector<char> m_raw;
+    QVector<scope_real> m_ingest;
+    QVector<std::complex<scope_real> > m_channel0;
+    char * m_block = NULL;              // [CAPTURE_WRITE_BYTES], aligned
+    QFile m_file;
+    qint64 m_next = -1;                 // next frame to save, -1 with no file open
+    qint64 m_end = -1;                  // frame to stop at, -1 while recording
+    qint64 m_fileBytes = 0;
+    qint64 m_lost = 0;                  // frames this file is missing
+};
+
+#endif /* capture_recorder_hpp */
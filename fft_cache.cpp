@@ -0,0 +1,155 @@
+//
+//  fft_cache.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <QtConcurrent>
+#include "fft_cache.hpp"
+
+template<typename Real>
+size_t FftPlan<Real>::bytes() const
+{
+    const size_t half = (size_t) howmany * (n/2 + 1);
+    const size_t full = (size_t) howmany * n;
+    switch(kind) {
+    case RealToComplex:
+    case ComplexToReal:
+        return full * sizeof(Real) + half * sizeof(complex);
+    case Forward2D:
+        return full * n * sizeof(complex);
+    default:
+        return 2 * full * sizeof(complex);
+    }
+}
+
+template<typename Real>
+FftCache<Real> & FftCache<Real>::instance()
+{
+    static FftCache cache;
+    return cache;
+}
+
+template<typename Real>
+typename FftCache<Real>::Plan * FftCache<Real>::acquire(typename Plan::Kind kind, int n, int howmany, Planning planning)
+{
+    {
+        QMutexLocker lock(&m_lock);
+        // a measured plan first, then for a quick one any match
+        for(int pass = 0; pass < (planning == Quick ? 2 : 1); pass++) {
+            for(int i = 0; i < m_idle.size(); i++) {
+                Plan * p = m_idle[i];
+                if(p->kind == kind && p->n == n && p->howmany == howmany && (pass == 1 || p->measured)) {
+                    m_idle.removeAt(i);
+                    m_idleBytes -= p->bytes();
+                    return p;
+                }
+            }
+        }
+        if(planning == Quick) {
+            for(int i = m_measuring.size() - 1; i >= 0; i--)
+                if(m_measuring[i].isFinished())
+                    m_measuring.removeAt(i);
+            m_measuring.append(QtConcurrent::run([this, kind, n, howmany]() {
+                release(make(kind, n, howmany, FFTW_MEASURE));
+            }));
+        }
+    }
+    return make(kind, n, howmany, planning == Quick ? FFTW_ESTIMATE : FFTW_MEASURE);
+}
+
+template<typename Real>
+void FftCache<Real>::release(Plan * plan)
+{
+    if(plan == NULL)
+        return;
+    QList<Plan *> evicted;
+    {
+        QMutexLocker lock(&m_lock);
+        m_idle.prepend(plan);
+        m_idleBytes += plan->bytes();
+        while(m_idle.size() > 1 && (m_idle.size() > FFT_CACHE_IDLE || m_idleBytes > FFT_CACHE_BYTES)) {
+            evicted.append(m_idle.takeLast());
+            m_idleBytes -= evicted.last()->bytes();
+        }
+    }
+    for(Plan * p : evicted)
+        destroy(p);
+}
+
+template<typename Real>
+void FftCache<Real>::clear()
+{
+    QList<QFuture<void> > measuring;
+    do {
+        for(QFuture<void> & f : measuring)
+            f.waitForFinished();
+        QMutexLocker lock(&m_lock);
+        measuring.swap(m_measuring);
+    } while(!measuring.isEmpty());
+
+    QList<Plan *> idle;
+    {
+        QMutexLocker lock(&m_lock);
+        idle.swap(m_idle);
+        m_idleBytes = 0;
+    }
+    for(Plan * p : idle)
+        destroy(p);
+}
+
+// FFTW_MEASURE overwrites the buffers while planning, which is fine for
+// fresh ones.
+template<typename Real>
+typename FftCache<Real>::Plan * FftCache<Real>::make(typename Plan::Kind kind, int n, int howmany, unsigned flags)
+{
+    Plan * p = new Plan;
+    p->kind = kind;
+    p->n = n;
+    p->howmany = howmany;
+    p->measured = flags == FFTW_MEASURE;
+    const size_t half = (size_t) howmany * (n/2 + 1);
+    const size_t full = (size_t) howmany * n;
+    switch(kind) {
+    case Plan::RealToComplex:
+        p->real = FFTW<Real>::alloc_real(full);
+        p->out = FFTW<Real>::alloc_complex(half);
+        p->plan = FFTW<Real>::plan_many_dft_r2c(1, &n, howmany, p->real, NULL, 1, n,
+                                                p->out, NULL, 1, n/2 + 1, flags);
+        break;
+    case Plan::ComplexToReal:
+        p->in = FFTW<Real>::alloc_complex(half);
+        p->real = FFTW<Real>::alloc_real(full);
+        p->plan = FFTW<Real>::plan_many_dft_c2r(1, &n, howmany, p->in, NULL, 1, n/2 + 1,
+                                                p->real, NULL, 1, n, flags);
+        break;
+    case Plan::Forward2D:
+        p->in = p->out = FFTW<Real>::alloc_complex(full * n);
+        p->plan = FFTW<Real>::plan_dft_2d(n, n, p->in, p->out, FFTW_FORWARD, flags);
+        break;
+    default:
+        p->in = FFTW<Real>::alloc_complex(full);
+        p->out = FFTW<Real>::alloc_complex(full);
+        p->plan = FFTW<Real>::plan_many_dft(1, &n, howmany, p->in, NULL, 1, n,
+                                            p->out, NULL, 1, n,
+                                            kind == Plan::Forward ? FFTW_FORWARD : FFTW_BACKWARD,
+                                            flags);
+        break;
+    }
+    return p;
+}
+
+template<typename Real>
+void FftCache<Real>::destroy(Plan * p)
+{
+    FFTW<Real>::destroy_plan(p->plan);
+    FFTW<Real>::free(p->real);
+    FFTW<Real>::free(p->in);
+    if(p->out != p->in)
+        FFTW<Real>::free(p->out);
+    delete p;
+}
+
+template struct FftPlan<scope_real>;
+template class FftCache<scope_real>;
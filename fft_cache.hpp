@@ -0,0 +1,91 @@
+//
+//  fft_cache.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef fft_cache_hpp
+#define fft_cache_hpp
+
+#include <QFuture>
+#include <QList>
+#include <QMutex>
+#include <complex>
+#include "fftw_traits.hpp"
+
+// idle plans kept for reuse, by count and by the size of their buffers
+#define FFT_CACHE_IDLE 24
+#define FFT_CACHE_BYTES (128 << 20)
+
+// An FFTW plan together with the buffers it was planned on. Which
+// buffers exist depends on the kind:
+//   RealToComplex  real[howmany*n]            -> out[howmany*(n/2+1)]
+//   ComplexToReal  in[howmany*(n/2+1)]        -> real[howmany*n]
+//   Forward        in[n]                      -> out[n]
+//   Backward       in[n]                      -> out[n]
+//   Forward2D      in[n*n], transformed in place (out == in)
+// Batches are contiguous, one transform after another.
+template<typename Real>
+struct FftPlan {
+    enum Kind {RealToComplex, ComplexToReal, Forward, Backward, Forward2D};
+    typedef std::complex<Real> complex;
+
+    Kind kind;
+    int n;
+    int howmany;
+    bool measured = false;      // FFTW_MEASURE rather than an estimate
+    typename FFTW<Real>::plan plan = NULL;
+    Real * real = NULL;
+    complex * in = NULL;
+    complex * out = NULL;
+
+    void execute() const {FFTW<Real>::execute(plan);}
+    size_t bytes() const;
+};
+
+// Process-wide LRU cache of plans and their buffers, keyed by kind, size
+// and batch count; the precision is the cache's own. A plan is held by
+// one owner at a time, from acquire() until release(), and released
+// plans stay planned and allocated until they are the least recently
+// used past FFT_CACHE_IDLE or FFT_CACHE_BYTES. Switching back to a size
+// seen before, such as after a sample rate change, costs no planning.
+//
+// Measuring a plan can take longer than a frame, so a scope's worker
+// asks for Quick plans: a measured one if the cache has it, otherwise an
+// estimate (itself measured if the wisdom has it) while a measured plan
+// of the same shape is made on the thread pool for the next acquire(),
+// and for the wisdom saved at exit.
+//
+// Thread-safe; planning happens outside the cache's lock.
+template<typename Real>
+class FftCache {
+public:
+    typedef FftPlan<Real> Plan;
+    enum Planning {Measured, Quick};
+
+    static FftCache & instance();
+
+    // A plan no one else holds; its buffers' contents are undefined.
+    Plan * acquire(typename Plan::Kind kind, int n, int howmany = 1, Planning planning = Measured);
+    // Hands a plan back; NULL is ignored.
+    void release(Plan * plan);
+    // Waits out any plans being measured, then destroys every idle plan.
+    void clear();
+
+private:
+    FftCache() {}
+    ~FftCache() {}
+    FftCache(const FftCache &) = delete;
+    FftCache & operator=(const FftCache &) = delete;
+
+    static Plan * make(typename Plan::Kind kind, int n, int howmany, unsigned flags);
+    static void destroy(Plan * plan);
+
+    QMutex m_lock;
+    QList<Plan *> m_idle;   // most recently released first
+    size_t m_idleBytes = 0;
+    QList<QFuture<void> > m_measuring;
+};
+
+#endif /* fft_cache_hpp */
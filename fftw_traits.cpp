@@ -0,0 +1,37 @@
+//
+//  fftw_traits.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <QDir>
+#include <QStandardPaths>
+#include "fftw_traits.hpp"
+#include "fft_cache.hpp"
+
+static QString wisdomPath()
+{
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    return dir.filePath(sizeof(scope_real) == sizeof(float) ? "fftwf.wisdom" : "fftw.wisdom");
+}
+
+void fftwInit()
+{
+    FFTW<scope_real>::init_threads();
+    FFTW<scope_real>::make_planner_thread_safe();
+    FFTW<scope_real>::plan_with_nthreads(FFTW_THREADS);
+    FFTW<scope_real>::import_wisdom_from_filename(wisdomPath().toLocal8Bit().constData());
+}
+
+void fftwSaveWisdom()
+{
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    FFTW<scope_real>::export_wisdom_to_filename(wisdomPath().toLocal8Bit().constData());
+}
+
+void fftwCleanup()
+{
+    FftCache<scope_real>::instance().clear();
+    FFTW<scope_real>::cleanup_threads();
+}
@@ -0,0 +1,117 @@
+//
+//  fftw_traits.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef fftw_traits_hpp
+#define fftw_traits_hpp
+
+#include <complex>
+#include <fftw3.h>
+#include "scope_real.hpp"
+
+// Precision policy for the scope DSP: FFTW<double> maps onto fftw_*,
+// FFTW<float> onto fftwf_*. Buffers are handed around as std::complex<Real>,
+// which is layout-compatible with FFTW's complex types.
+template<typename Real> struct FFTW;
+
+#define XYSCOPE_FFTW_TRAITS(REAL, X)                                            \
+template<> struct FFTW<REAL> {                                                  \
+    typedef X##plan plan;                                                       \
+    typedef std::complex<REAL> complex;                                         \
+                                                                                \
+    static REAL * alloc_real(size_t n) {return X##alloc_real(n);}               \
+    static complex * alloc_complex(size_t n) {                                  \
+        return reinterpret_cast<complex *>(X##alloc_complex(n));                \
+    }                                                                           \
+    static void free(void * p) {X##free(p);}                                    \
+                                                                                \
+    static plan plan_dft_1d(int n, complex * in, complex * out,                 \
+                            int sign, unsigned flags) {                         \
+        return X##plan_dft_1d(n, reinterpret_cast<X##complex *>(in),            \
+                              reinterpret_cast<X##complex *>(out), sign, flags);\
+    }                                                                           \
+    static plan plan_dft_r2c_1d(int n, REAL * in, complex * out,                \
+                                unsigned flags) {                               \
+        return X##plan_dft_r2c_1d(n, in,                                        \
+                                  reinterpret_cast<X##complex *>(out), flags);  \
+    }                                                                           \
+    static plan plan_dft_c2r_1d(int n, complex * in, REAL * out,                \
+                                unsigned flags) {                               \
+        return X##plan_dft_c2r_1d(n, reinterpret_cast<X##complex *>(in),        \
+                                  out, flags);                                  \
+    }                                                                           \
+    static plan plan_many_dft_r2c(int rank, const int * n, int howmany,         \
+                                  REAL * in, const int * inembed,               \
+                                  int istride, int idist,                       \
+                                  complex * out, const int * onembed,           \
+                                  int ostride, int odist, unsigned flags) {     \
+        return X##plan_many_dft_r2c(rank, n, howmany, in, inembed, istride,     \
+                                    idist, reinterpret_cast<X##complex *>(out), \
+                                    onembed, ostride, odist, flags);            \
+    }                                                                           \
+    static plan plan_many_dft_c2r(int rank, const int * n, int howmany,         \
+                                  complex * in, const int * inembed,            \
+                                  int istride, int idist,                       \
+                                  REAL * out, const int * onembed,              \
+                                  int ostride, int odist, unsigned flags) {     \
+        return X##plan_many_dft_c2r(rank, n, howmany,                           \
+                                    reinterpret_cast<X##complex *>(in), inembed,\
+                                    istride, idist, out, onembed, ostride,      \
+                                    odist, flags);                              \
+    }                                                                           \
+    static plan plan_many_dft(int rank, const int * n, int howmany,             \
+                              complex * in, const int * inembed,                \
+                              int istride, int idist,                           \
+                              complex * out, const int * onembed,               \
+                              int ostride, int odist, int sign,                 \
+                              unsigned flags) {                                 \
+        return X##plan_many_dft(rank, n, howmany,                               \
+                                reinterpret_cast<X##complex *>(in), inembed,    \
+                                istride, idist,                                 \
+                                reinterpret_cast<X##complex *>(out), onembed,   \
+                                ostride, odist, sign, flags);                   \
+    }                                                                           \
+    static plan plan_dft_2d(int n0, int n1, complex * in, complex * out,        \
+                            int sign, unsigned flags) {                         \
+        return X##plan_dft_2d(n0, n1, reinterpret_cast<X##complex *>(in),       \
+                              reinterpret_cast<X##complex *>(out), sign, flags);\
+    }                                                                           \
+    static void execute(const plan p) {X##execute(p);}                          \
+    static void execute_dft(const plan p, complex * in, complex * out) {        \
+        X##execute_dft(p, reinterpret_cast<X##complex *>(in),                   \
+                       reinterpret_cast<X##complex *>(out));                    \
+    }                                                                           \
+    static void destroy_plan(plan p) {X##destroy_plan(p);}                      \
+                                                                                \
+    static int init_threads() {return X##init_threads();}                       \
+    static void plan_with_nthreads(int n) {X##plan_with_nthreads(n);}           \
+    static void cleanup_threads() {X##cleanup_threads();}                       \
+    static void make_planner_thread_safe() {X##make_planner_thread_safe();}     \
+                                                                                \
+    static int import_wisdom_from_filename(const char * f) {                    \
+        return X##import_wisdom_from_filename(f);                               \
+    }                                                                           \
+    static int export_wisdom_to_filename(const char * f) {                      \
+        return X##export_wisdom_to_filename(f);                                 \
+    }                                                                           \
+};
+
+XYSCOPE_FFTW_TRAITS(double, fftw_)
+XYSCOPE_FFTW_TRAITS(float, fftwf_)
+
+#undef XYSCOPE_FFTW_TRAITS
+
+// threads each FFTW plan may use
+#define FFTW_THREADS 4
+
+// Process-wide FFTW setup for scope_real: threads, a planner that scopes
+// may call from background threads, and wisdom cached per user so that
+// FFTW_MEASURE planning is only paid once per size.
+void fftwInit();
+void fftwSaveWisdom();
+void fftwCleanup();
+
+#endif /* fftw_traits_hpp */
@@ -0,0 +1,74 @@
+//
+//  frame_pacer.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include "frame_pacer.hpp"
+#include "scope_stats.hpp"
+
+FramePacer::FramePacer(QObject * parent) : QObject(parent), m_pending(0)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &FramePacer::fire);
+}
+
+void FramePacer::setTargetFps(int fps)
+{
+    m_targetFps = qMax(1, fps);
+}
+
+void FramePacer::setDisplayFps(qreal hz)
+{
+    m_displayFps = hz;
+}
+
+qint64 FramePacer::intervalNs() const
+{
+    qreal fps = m_targetFps;
+    if(m_displayFps > 0)
+        fps = qMin(fps, m_displayFps);
+    return (qint64) (1e9 / fps);
+}
+
+void FramePacer::setPaused(bool paused)
+{
+    m_paused = paused;
+    if(paused) {
+        m_timer.stop();
+        m_pending.storeRelease(0);
+    }
+}
+
+// Only the first frame after a present() queues anything; the rest are
+// covered by the repaint already on its way.
+void FramePacer::frameReady()
+{
+    if(m_pending.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, [this]() {schedule();}, Qt::QueuedConnection);
+}
+
+void FramePacer::schedule()
+{
+    if(m_paused) {
+        m_pending.storeRelease(0);
+        return;
+    }
+    const qint64 wait = m_last + intervalNs() - ScopeStats::now();
+    if(wait <= 0)
+        fire();
+    else
+        m_timer.start((int) ((wait + 999999) / 1000000));
+}
+
+void FramePacer::fire()
+{
+    // frames published from here on schedule the next present()
+    m_pending.storeRelease(0);
+    if(m_paused)
+        return;
+    m_last = ScopeStats::now();
+    emit present();
+}
@@ -0,0 +1,57 @@
+//
+//  frame_pacer.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef frame_pacer_hpp
+#define frame_pacer_hpp
+
+#include <QObject>
+#include <QTimer>
+#include <QAtomicInt>
+
+#define PACER_DEFAULT_FPS 60
+
+// Turns completed scope frames into repaints. Nothing is scheduled until
+// a scope publishes a new frame; then present() fires as soon as one
+// frame interval has passed since the last one, the interval being the
+// target rate capped to the display's. With no new frames, or while
+// paused, no timer runs at all.
+//
+// frameReady() may be called from any thread (it is the scopes' frame
+// sink); everything else belongs to the GUI thread.
+class FramePacer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FramePacer(QObject * parent = nullptr);
+
+    void setTargetFps(int fps);
+    int targetFps() const {return m_targetFps;}
+    // display refresh rate, 0 if unknown
+    void setDisplayFps(qreal hz);
+    qint64 intervalNs() const;
+
+    void setPaused(bool paused);
+    bool paused() const {return m_paused;}
+
+    void frameReady();
+
+signals:
+    void present();
+
+private:
+    void schedule();
+    void fire();
+
+    QTimer m_timer;
+    QAtomicInt m_pending;       // a schedule() is queued or the timer armed
+    int m_targetFps = PACER_DEFAULT_FPS;
+    qreal m_displayFps = 0;
+    qint64 m_last = 0;          // ScopeStats::now() of the last present()
+    bool m_paused = false;
+};
+
+#endif /* frame_pacer_hpp */
@@ -0,0 +1,109 @@
+//
+//  hilbert_filter.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <cstring>
+#include <qmath.h>
+#include "hilbert_filter.hpp"
+
+template<typename Real>
+HilbertFilter<Real>::HilbertFilter(int taps)
+{
+    setTaps(taps);
+}
+
+template<typename Real>
+HilbertFilter<Real>::~HilbertFilter()
+{
+    release();
+}
+
+template<typename Real>
+void HilbertFilter<Real>::release()
+{
+    FftCache<Real>::instance().release(m_forward);
+    FftCache<Real>::instance().release(m_inverse);
+    m_forward = m_inverse = NULL;
+}
+
+template<typename Real>
+void HilbertFilter<Real>::setTaps(int taps)
+{
+    taps = qBound(HILBERT_MIN_TAPS, taps | 1, HILBERT_MAX_TAPS);
+    if(taps == m_taps)
+        return;
+    release();
+    m_taps = taps;
+
+    // Four times the overlap keeps most of each FFT new samples.
+    m_size = 1024;
+    while(m_size < 4 * (m_taps - 1))
+        m_size *= 2;
+    m_block = m_size - (m_taps - 1);
+
+    m_forward = FftCache<Real>::instance().acquire(FftPlan<Real>::RealToComplex, m_size, 1, FftCache<Real>::Quick);
+    m_inverse = FftCache<Real>::instance().acquire(FftPlan<Real>::ComplexToReal, m_size, 1, FftCache<Real>::Quick);
+
+    // Ideal transformer 2/(pi n) at odd n, zero at even n, under a
+    // Blackman window, centred on the delay.
+    const int D = delay();
+    Real * h = m_forward->real;
+    memset(h, 0, m_size * sizeof(Real));
+    for(int k = 0; k < m_taps; k++) {
+        const int n = k - D;
+        if(n % 2 == 0)
+            continue;
+        const double w = 0.42 - 0.5*qCos(2*M_PI*k/(m_taps - 1)) + 0.08*qCos(4*M_PI*k/(m_taps - 1));
+        h[k] = (Real) (w * 2.0 / (M_PI * n));
+    }
+    m_forward->execute();
+    m_kernel.resize(m_size/2 + 1);
+    for(int k = 0; k <= m_size/2; k++)
+        m_kernel[k] = m_forward->out[k] / (Real) m_size;
+
+    reset();
+}
+
+template<typename Real>
+void HilbertFilter<Real>::reset()
+{
+    memset(m_forward->real, 0, m_size * sizeof(Real));
+}
+
+// Overlap-save: each FFT sees taps-1 old samples then up to m_block new
+// ones; outputs at and after index taps-1 are free of circular wrap.
+template<typename Real>
+void HilbertFilter<Real>::process(const Real * x, quint32 len, complex * out)
+{
+    const int history = m_taps - 1;
+    const int D = delay();
+    Real * buf = m_forward->real;
+    const complex * spec = m_forward->out;
+    complex * prod = m_inverse->in;
+    const Real * conv = m_inverse->real;
+    while(len > 0) {
+        const int n = (int) qMin(len, (quint32) m_block);
+        memcpy(buf + history, x, n * sizeof(Real));
+        // a short last block pads with zeros, which only reach outputs
+        // past the ones kept
+        memset(buf + history + n, 0, (m_block - n) * sizeof(Real));
+
+        m_forward->execute();
+        for(int k = 0; k <= m_size/2; k++)
+            prod[k] = spec[k] * m_kernel[k];
+        m_inverse->execute();
+
+        for(int i = 0; i < n; i++)
+            out[i] = complex(buf[history + i - D], conv[history + i]);
+
+        memmove(buf, buf + n, history * sizeof(Real));
+        x += n;
+        out += n;
+        len -= n;
+    }
+}
+
+template class HilbertFilter<scope_real>;
@@ -0,0 +1,64 @@
+//
+//  hilbert_filter.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef hilbert_filter_hpp
+#define hilbert_filter_hpp
+
+#include <QtGlobal>
+#include <QVector>
+#include <complex>
+#include "fft_cache.hpp"
+
+// default FIR length; odd, so the kernel has a whole-sample delay
+#define HILBERT_TAPS 255
+#define HILBERT_MIN_TAPS 15
+#define HILBERT_MAX_TAPS 4095
+
+// Streaming analytic signal: z[n] = x[n-D] + j*H{x}[n-D], where H is a
+// Blackman-windowed FIR Hilbert transformer of `taps` taps and D its
+// (taps-1)/2 sample delay. The FIR runs as overlap-save block convolution
+// on plans from FftCache, and the last taps-1 input samples carry over
+// between process() calls, so output is continuous across calls of any
+// length.
+//
+// Owned by the thread running the scope's DSP.
+template<typename Real>
+class HilbertFilter {
+public:
+    typedef std::complex<Real> complex;
+
+    explicit HilbertFilter(int taps = HILBERT_TAPS);
+    ~HilbertFilter();
+
+    // Rebuilds the kernel (rounded up to odd, clamped) and reset()s.
+    void setTaps(int taps);
+    int taps() const  {return m_taps;}
+    int delay() const {return (m_taps - 1) / 2;}
+
+    // Forgets the input history, as if fed silence.
+    void reset();
+
+    // Filters the next `len` input samples into `len` outputs.
+    void process(const Real * x, quint32 len, complex * out);
+
+private:
+    HilbertFilter(const HilbertFilter &) = delete;
+    HilbertFilter & operator=(const HilbertFilter &) = delete;
+
+    void release();
+
+    int m_taps = 0;
+    int m_size = 0;             // FFT length
+    int m_block = 0;            // new samples per FFT, m_size - (m_taps-1)
+    // The forward plan's input holds taps-1 samples of history, then the
+    // block; r2c leaves its input alone, so the history survives.
+    FftPlan<Real> * m_forward = NULL;
+    FftPlan<Real> * m_inverse = NULL;
+    QVector<complex> m_kernel;  // spectrum of the FIR, scaled by 1/m_size
+};
+
+#endif /* hilbert_filter_hpp */
@@ -0,0 +1,79 @@
+//
+//  jitter_buffer.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <cstring>
+#include "jitter_buffer.hpp"
+
+JitterBuffer::JitterBuffer(int depth) : m_depth(qBound(0, depth, JITTER_SLOTS - 1))
+{
+    m_seq.fill(-1, JITTER_SLOTS);
+}
+
+void JitterBuffer::reset()
+{
+    m_bytes = 0;
+    m_started = false;
+    m_seq.fill(-1);
+}
+
+void JitterBuffer::restart(qint64 seq)
+{
+    m_seq.fill(-1);
+    m_next = seq;
+    m_newest = seq;
+    m_started = true;
+}
+
+bool JitterBuffer::put(quint32 seq, const char * payload, int bytes)
+{
+    if(m_bytes == 0) {
+        m_bytes = bytes;
+        m_packets.resize(JITTER_SLOTS * bytes);
+        m_silence.fill(0, bytes);
+    }
+    if(bytes != m_bytes)
+        return false;
+
+    // unwrapped relative to the newest, so it survives the 32-bit wrap
+    qint64 s = m_newest + (qint32) (seq - (quint32) m_newest);
+    if(!m_started) {
+        s = seq;
+        restart(s);
+    } else if(s < m_next - JITTER_SLOTS || s >= m_next + JITTER_SLOTS) {
+        // Too far from play-out either way to be reordering: the sender
+        // started over, or more than the buffer holds went missing.
+        if(s > m_next)
+            m_lost += s - m_next;
+        // a jump back past zero would unwrap negative
+        s = seq;
+        restart(s);
+    } else if(s < m_next) {
+        m_late++;
+        return false;
+    }
+
+    const int slot = (int) (s & (JITTER_SLOTS - 1));
+    memcpy(m_packets.data() + (size_t) slot * m_bytes, payload, m_bytes);
+    m_seq[slot] = s;
+    m_newest = qMax(m_newest, s);
+    return true;
+}
+
+const char * JitterBuffer::take()
+{
+    if(!m_started || m_newest - m_next < m_depth)
+        return NULL;
+    const int slot = (int) (m_next & (JITTER_SLOTS - 1));
+    const char * packet = m_silence.constData();
+    if(m_seq[slot] == m_next)
+        packet = m_packets.constData() + (size_t) slot * m_bytes;
+    else
+        m_lost++;
+    m_seq[slot] = -1;
+    m_next++;
+    return packet;
+}
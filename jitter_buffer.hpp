@@ -0,0 +1,63 @@
+//
+//  jitter_buffer.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef jitter_buffer_hpp
+#define jitter_buffer_hpp
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QVector>
+
+// packets held back before play-out
+#define JITTER_DEFAULT_DEPTH 4
+// packets the buffer can hold, a power of two; also how far a sequence
+// number may jump before the buffer takes it as the sender starting over
+#define JITTER_SLOTS 64
+
+// Puts numbered packets of a stream back in order. Play-out runs `depth`
+// packets behind the newest one seen, so packets that arrive out of
+// order within that window slot back into place. Any still missing when
+// their turn comes play as silence, and any arriving after it are
+// dropped.
+//
+// Every packet carries the same number of bytes, set by the first one.
+// Sequence numbers are 32 bits and wrap.
+//
+// Owned by the thread receiving the packets.
+class JitterBuffer {
+public:
+    explicit JitterBuffer(int depth = JITTER_DEFAULT_DEPTH);
+
+    // Forgets the stream; the next packet starts it over.
+    void reset();
+
+    // Takes packet `seq`; false if it came too late or is the wrong size.
+    bool put(quint32 seq, const char * payload, int bytes);
+    // The next packet due, valid until the next put(), or NULL while
+    // play-out is waiting on the window to fill.
+    const char * take();
+    int packetBytes() const {return m_bytes;}
+
+    quint64 lost() const {return m_lost;}
+    quint64 late() const {return m_late;}
+
+private:
+    void restart(qint64 seq);
+
+    int m_depth;
+    int m_bytes = 0;
+    QByteArray m_packets;       // [JITTER_SLOTS][bytes]
+    QVector<qint64> m_seq;      // what each slot holds, -1 for nothing
+    QByteArray m_silence;
+    bool m_started = false;
+    qint64 m_next = 0;          // to play out next, unwrapped
+    qint64 m_newest = 0;
+    quint64 m_lost = 0;
+    quint64 m_late = 0;
+};
+
+#endif /* jitter_buffer_hpp */
@@ -15,81 +15,112 @@
 #include <QScopedPointer>
 #include <QAudioInput>
 #include <qendian.h>
+#include <cstring>
+#include <cstdio>
 
 #include "raster_view.hpp"
 #include "raster_image.hpp"
 #include "analytic_scope.hpp"
 #include "spectrum_scope.hpp"
+#include "xy_scope.hpp"
+#include "offline_render.hpp"
+#include "frame_pacer.hpp"
+#include "capture_recorder.hpp"
+#include "sample_source.hpp"
 
 
 
-class AudioInfo : public QIODevice
-{
-    Q_OBJECT
+// scopes one capture stream can feed at once
+#define AUDIO_MAX_SINKS 4
 
+// The capture path: every source's blocks come through here, on the
+// source's thread, on their way to the recorder and the scopes shown.
+class AudioInfo
+{
 public:
-    AudioInfo(const QAudioFormat &format);
+    // blocks arrive in `format`; every one also goes, raw, to `recorder`
+    AudioInfo(const SampleFormat &format, CaptureRecorder * recorder);
 
-    void start();
-    void stop();
+    // GUI side, while capture runs: the slots are atomic, so a scope
+    // joins or leaves the fan-out without stopping the input. A scope
+    // that was just removed may still be fed once more.
+    void addSink(RasterImage * scope);
+    void removeSink(RasterImage * scope);
 
-    qint16 * dataFrame() const {return m_dataFrame;}
-    quint64 dataLen() const {return m_dataLen;}
+    void write(const char *data, quint32 numFrames);
 
-    qint64 readData(char *data, qint64 maxlen) override;
-    qint64 writeData(const char *data, qint64 len) override;
+    // time spent in ingest() and the samples it converted, while stats
+    // are on; read from the GUI
+    quint64 ingestNs() const {return m_ingestNs.loadRelaxed();}
+    quint64 ingested() const {return m_ingested.loadRelaxed();}
 
 private:
-    const QAudioFormat m_format;
-    qint16 * m_dataFrame;
-    quint64 m_dataLen;
-    QMutex * m_mutex;
-
-signals:
-    void update();
+    const SampleFormat m_format;
+    CaptureRecorder * m_recorder;
+    QVector<scope_real> m_ingest;       // conversion scratch, shared by the sinks
+    QAtomicPointer<RasterImage> m_sinks[AUDIO_MAX_SINKS];
+    QAtomicInteger<quint64> m_ingestNs;
+    QAtomicInteger<quint64> m_ingested;
 };
 
-AudioInfo::AudioInfo(const QAudioFormat &format)
-    : m_format(format)
+AudioInfo::AudioInfo(const SampleFormat &format, CaptureRecorder * recorder)
+    : m_format(format), m_recorder(recorder)
 {
-    m_dataLen = 0;
-    m_dataFrame = new qint16[FRAME_SIZE];
-    m_mutex = new QMutex();
+    m_ingest.resize(INGEST_FRAMES * m_format.channels);
+    for(int i = 0; i < AUDIO_MAX_SINKS; i++)
+        m_sinks[i].storeRelaxed(nullptr);
+    m_ingestNs.storeRelaxed(0);
+    m_ingested.storeRelaxed(0);
 }
 
-void AudioInfo::start()
+void AudioInfo::addSink(RasterImage * scope)
 {
-    open(QIODevice::WriteOnly);
-}
-
-void AudioInfo::stop()
-{
-    close();
+    for(int i = 0; i < AUDIO_MAX_SINKS; i++)
+        if(m_sinks[i].loadAcquire() == nullptr) {
+            m_sinks[i].storeRelease(scope);
+            return;
+        }
+    qWarning() << "No capture slot left for another scope";
 }
 
-qint64 AudioInfo::readData(char *data, qint64 maxlen)
+void AudioInfo::removeSink(RasterImage * scope)
 {
-    Q_UNUSED(data)
-    Q_UNUSED(maxlen)
-
-    return 0;
+    for(int i = 0; i < AUDIO_MAX_SINKS; i++)
+        if(m_sinks[i].loadAcquire() == scope)
+            m_sinks[i].storeRelease(nullptr);
 }
 
-qint64 AudioInfo::writeData(const char *data, qint64 len)
+void AudioInfo::write(const char *data, quint32 numFrames)
 {
-    Q_ASSERT(m_format.sampleSize() % 8 == 0);
-    const int channelBytes = m_format.sampleSize() / 8;
-    const int sampleBytes = m_format.channelCount() * channelBytes;
-    Q_ASSERT(len % sampleBytes == 0);
-    const int numSamples = len / sampleBytes;
-
-    if(m_mutex->tryLock()) {
-        memcpy(m_dataFrame, data, numSamples * m_format.channelCount() * channelBytes);
-        m_dataLen = numSamples * m_format.channelCount();
-        emit update();
-        m_mutex->unlock();
+    const int frameBytes = m_format.bytesPerFrame();
+    m_recorder->write(data, numFrames);
+
+    // Converted once, in cache-sized blocks, for every scope shown. The
+    // scopes copy into their own rings and never block here, so a slow
+    // one only drops its own frames.
+    RasterImage * sinks[AUDIO_MAX_SINKS];
+    int count = 0;
+    for(int i = 0; i < AUDIO_MAX_SINKS; i++)
+        if((sinks[count] = m_sinks[i].loadAcquire()) != nullptr)
+            count++;
+    if(count == 0)
+        return;
+    const bool timed = ScopeStats::enabled();
+    while(numFrames > 0) {
+        const quint32 n = qMin(numFrames, (quint32) INGEST_FRAMES);
+        const qint64 start = timed ? ScopeStats::now() : 0;
+        ingest(data, n * m_format.channels, m_format, m_ingest.data());
+        if(timed) {
+            m_ingestNs.fetchAndAddRelaxed(ScopeStats::now() - start);
+            m_ingested.fetchAndAddRelaxed(n * m_format.channels);
+        }
+        for(int i = 0; i < count; i++)
+            sinks[i]->feed(m_ingest.constData(), n);
+        data += n * frameBytes;
+        numFrames -= n;
     }
-    return len;
+    for(int i = 0; i < count; i++)
+        sinks[i]->wake();
 }
 
 class Window : public QMainWindow
@@ -99,8 +130,29 @@ class Window : public QMainWindow
 public:
     
     explicit Window();
+    // the scopes' workers call into m_pacer; stop them before it goes
+    ~Window() {
+        m_source.reset();
+        for(RasterImage * scope : {(RasterImage *) analytic_scope, (RasterImage *) spectrum_scope, (RasterImage *) xy_scope})
+            if(scope != nullptr)
+                scope->quit();
+        delete analytic_scope;
+        delete spectrum_scope;
+        delete xy_scope;
+    }
     
-    void initializeAudio(const QAudioDeviceInfo &deviceInfo);
+    // Input other than an audio device; see sample_source.hpp.
+    void replayFile(const QString & path, bool fast);
+    void readStdin();
+    void listen(NetworkSource::Protocol protocol, quint16 port);
+    // JSON lines of hot path stats on stderr, once a second
+    void setStatsOutput(bool on) {m_statsOutput = on; updateStats();}
+    void setTargetFps(int fps);
+    // capture at `rate` Hz rather than the device's preferred rate
+    void setSampleRate(int rate);
+    // where captures are saved, and the level that triggers one
+    void setCaptureDir(const QString & dir);
+    void setCaptureLevel(qreal level);
     
     void keyPressEvent(QKeyEvent * event) override {
         switch(event->key())
@@ -108,6 +160,16 @@ public:
             case Qt::Key_Space:
                 toggleSuspend();
                 break;
+            case Qt::Key_H:
+                m_canvas->setHud(!m_canvas->hudShown());
+                updateStats();
+                break;
+            case Qt::Key_R:
+                rearmTrigger();
+                break;
+            case Qt::Key_C:
+                m_recorder.snapshot();
+                break;
         }
     }
 signals:
@@ -115,12 +177,21 @@ signals:
     
 protected:
     void resizeEvent(QResizeEvent *) override;
+    // hidden or minimized, the window stops capturing and rendering
+    void showEvent(QShowEvent *) override {setIdle(false);}
+    void hideEvent(QHideEvent *) override {setIdle(true);}
+    void changeEvent(QEvent * event) override {
+        if(event->type() == QEvent::WindowStateChange)
+            setIdle(isMinimized());
+        QMainWindow::changeEvent(event);
+    }
 
 private slots:
     void toggleSuspend();
     void deviceChanged(const QAudioDeviceInfo & device);
     void viewChanged(bool);
     void resizeTimeout();
+    void reportStats();
     
 
 
@@ -128,21 +199,72 @@ private:
     // Owned by layout
     RasterView *m_canvas = nullptr;
     QVBoxLayout *m_layout = nullptr;
-    QTimer *m_timer = nullptr;
-    QMetaObject::Connection & timerConnection;
-    QMetaObject::Connection & audioUpdateConnection;
+    QSplitter *m_splitter = nullptr;
+    // split screen: a view for each scope other than the active one
+    QVector<RasterView *> m_panes;
+    FramePacer * m_pacer = nullptr;
+    QActionGroup * m_fpsGroup = nullptr;
+    bool m_paused = false;      // by the user
+    bool m_idle = true;         // not visible; the first show clears it
+    QMetaObject::Connection m_screenChanged;
+    void setIdle(bool idle);
+    void runScope(bool run);
+    void updateDisplayFps();
 
     QScopedPointer<AudioInfo> m_audioInfo;
-    QScopedPointer<QAudioInput> m_audioInput;
+    QScopedPointer<SampleSource> m_source;
+    // builds the current source again, for a change of channels or rate
+    std::function<SampleSource *()> m_makeSource;
+    bool openSource(const std::function<SampleSource *()> & make);
+    void reopenSource(int channels, int rate);
+    void closeSource();
 
     QMenu * sourcesMenu;
     QMenu * viewsMenu;
+    QMenu * channelsMenu;
     QAction * hilbertScanAction;
     QAction * spectrumAction;
+    QAction * xyAction;
+    QAction * perChannelAction;
+    QAction * splitAction;
+    
+    QAction * fastReplayAction;
+    int m_channels = 1;         // requested; the device may give fewer
+    int m_rate = 0;             // requested; 0 for the device's preferred
+    int m_triggerEdge = Trigger<scope_real>::Rising;
+    int m_triggerMode = Trigger<scope_real>::Normal;
+    void triggerChanged();
+    void rearmTrigger();
+    SampleFormat m_captureFormat;   // what the device gave
+    CaptureRecorder m_recorder;
+    QAction * captureTriggerAction;
+    QAction * recordAction;
+    void captureChanged();
+    void channelsChanged(int channels);
     
-    AnalyticScope * analytic_scope;
-    SpectrumScope * spectrum_scope;
+    // built the first time their view is selected
+    AnalyticScope * analytic_scope = nullptr;
+    SpectrumScope * spectrum_scope = nullptr;
+    XYScope * xy_scope = nullptr;
     RasterImage * active_scope;
+    RasterImage * scopeFor(const QAction * view);
+    // scopes on screen, the active one first, and those capture feeds
+    QVector<RasterImage *> shownScopes();
+    QVector<RasterImage *> m_attached;
+    void attach(RasterImage * scope);
+    void detach(RasterImage * scope);
+    void layoutPanes();
+
+    QTimer * m_statsTimer;
+    bool m_statsOutput = false;
+    ScopeStats::Totals m_lastStats;
+    qint64 m_lastStatsTime = 0;
+    void updateStats();
+    ScopeStats::Totals stats() const;
+    void resetStats() {
+        m_lastStats = stats();
+        m_lastStatsTime = ScopeStats::now();
+    }
     static const int RESIZE_TIMEOUT = 250;
     QTimer* resizeTimer;
     
@@ -163,21 +285,18 @@ void Window::resizeTimeout()
     
 }
 
-Window::Window() : QMainWindow(),
-timerConnection(*(new QMetaObject::Connection)),
-audioUpdateConnection(*(new QMetaObject::Connection))
+Window::Window() : QMainWindow()
 {
     QWidget *window = new QWidget;
     m_layout = new QVBoxLayout;
-    m_timer = new QTimer();
-    
-    unsigned int refresh_rate = 25; // refresh/S
+    m_pacer = new FramePacer(this);
 
     m_canvas = new RasterView(this);
-    
+    m_splitter = new QSplitter(Qt::Horizontal, this);
+    m_splitter->addWidget(m_canvas);
     
     m_layout->setMargin(0);
-    m_layout->addWidget(m_canvas);
+    m_layout->addWidget(m_splitter);
     
     sourcesMenu = menuBar()->addMenu(tr("&Source"));
     
@@ -190,6 +309,32 @@ audioUpdateConnection(*(new QMetaObject::Connection))
     
         sourcesMenu->addAction(srcAction);
     }
+    sourcesMenu->addSeparator();
+    QAction * replayAction = new QAction(tr("Replay File..."), this);
+    connect(replayAction, &QAction::triggered, this, [this]() {
+        const QString path = QFileDialog::getOpenFileName(this, tr("Replay File"), QString(),
+                                                          tr("Audio (*.wav *.raw *.pcm);;All Files (*)"));
+        if(!path.isEmpty())
+            replayFile(path, fastReplayAction->isChecked());
+    });
+    sourcesMenu->addAction(replayAction);
+    fastReplayAction = new QAction(tr("Replay As Fast As Possible"), this);
+    fastReplayAction->setCheckable(true);
+    sourcesMenu->addAction(fastReplayAction);
+    QAction * stdinAction = new QAction(tr("Standard Input (s16le)"), this);
+    connect(stdinAction, &QAction::triggered, this, &Window::readStdin);
+    sourcesMenu->addAction(stdinAction);
+    for(NetworkSource::Protocol protocol : {NetworkSource::Udp, NetworkSource::Tcp}) {
+        const QString title = protocol == NetworkSource::Udp ? tr("Listen on UDP") : tr("Listen on TCP");
+        QAction * netAction = new QAction(title + "...", this);
+        connect(netAction, &QAction::triggered, this, [this, protocol, title]() {
+            bool ok = false;
+            const int port = QInputDialog::getInt(this, title, tr("Port:"), NETWORK_DEFAULT_PORT, 1, 65535, 1, &ok);
+            if(ok)
+                listen(protocol, port);
+        });
+        sourcesMenu->addAction(netAction);
+    }
     
     viewsMenu = menuBar()->addMenu(tr("&View"));
     hilbertScanAction = new QAction(tr("Analytic Signal Scan"), this);
@@ -198,67 +343,273 @@ audioUpdateConnection(*(new QMetaObject::Connection))
     spectrumAction = new QAction(tr("Spectrum"), this);
     connect(spectrumAction, &QAction::triggered, this, &Window::viewChanged);
     viewsMenu->addAction(spectrumAction);
+    xyAction = new QAction(tr("X/Y"), this);
+    connect(xyAction, &QAction::triggered, this, &Window::viewChanged);
+    viewsMenu->addAction(xyAction);
+    viewsMenu->addSeparator();
+    perChannelAction = new QAction(tr("Analyze Each Channel"), this);
+    perChannelAction->setCheckable(true);
+    connect(perChannelAction, &QAction::toggled, this, [this](bool on) {
+        if(analytic_scope != nullptr)
+            analytic_scope->setPerChannel(on);
+    });
+    viewsMenu->addAction(perChannelAction);
+    splitAction = new QAction(tr("Split Screen"), this);
+    splitAction->setCheckable(true);
+    connect(splitAction, &QAction::toggled, this, [this](bool) {
+        layoutPanes();
+    });
+    viewsMenu->addAction(splitAction);
+    QMenu * fpsMenu = viewsMenu->addMenu(tr("Frame Rate"));
+    m_fpsGroup = new QActionGroup(this);
+    for(int fps : {30, 60, 120, 144}) {
+        QAction * fpsAction = new QAction(tr("%1 fps").arg(fps), this);
+        fpsAction->setCheckable(true);
+        fpsAction->setData(fps);
+        m_fpsGroup->addAction(fpsAction);
+        connect(fpsAction, &QAction::triggered, this, [this, fps]() {
+            setTargetFps(fps);
+        });
+        fpsMenu->addAction(fpsAction);
+    }
+    setTargetFps(PACER_DEFAULT_FPS);
+
+    channelsMenu = menuBar()->addMenu(tr("&Channels"));
+    QActionGroup * channelGroup = new QActionGroup(this);
+    int maxChannels = 2;
+    for(int n : defaultDeviceInfo.supportedChannelCounts())
+        maxChannels = qMax(maxChannels, n);
+    QList<int> channelCounts = {1, 2};
+    if(maxChannels > 2)
+        channelCounts << maxChannels;
+    for(int n : channelCounts) {
+        QAction * chAction = new QAction(n == 1 ? tr("Mono") : n == 2 ? tr("Stereo") : tr("%1 Channels").arg(n), this);
+        chAction->setCheckable(true);
+        chAction->setChecked(n == m_channels);
+        channelGroup->addAction(chAction);
+        connect(chAction, &QAction::triggered, this, [this, n]() {
+            channelsChanged(n);
+        });
+        channelsMenu->addAction(chAction);
+    }
+
+    QMenu * triggerMenu = menuBar()->addMenu(tr("&Trigger"));
+    QActionGroup * edgeGroup = new QActionGroup(this);
+    for(int e = 0; e < Trigger<scope_real>::EdgeCount; e++) {
+        QAction * edgeAction = new QAction(tr(Trigger<scope_real>::edgeName(e)), this);
+        edgeAction->setCheckable(true);
+        edgeAction->setChecked(e == m_triggerEdge);
+        edgeGroup->addAction(edgeAction);
+        connect(edgeAction, &QAction::triggered, this, [this, e]() {
+            m_triggerEdge = e;
+            triggerChanged();
+        });
+        triggerMenu->addAction(edgeAction);
+    }
+    triggerMenu->addSeparator();
+    QActionGroup * modeGroup = new QActionGroup(this);
+    for(int m = 0; m < Trigger<scope_real>::ModeCount; m++) {
+        QAction * modeAction = new QAction(tr(Trigger<scope_real>::modeName(m)), this);
+        modeAction->setCheckable(true);
+        modeAction->setChecked(m == m_triggerMode);
+        modeGroup->addAction(modeAction);
+        connect(modeAction, &QAction::triggered, this, [this, m]() {
+            m_triggerMode = m;
+            triggerChanged();
+        });
+        triggerMenu->addAction(modeAction);
+    }
+    triggerMenu->addSeparator();
+    QAction * rearmAction = new QAction(tr("Re-arm Single Shot (R)"), this);
+    connect(rearmAction, &QAction::triggered, this, &Window::rearmTrigger);
+    triggerMenu->addAction(rearmAction);
+
+    QMenu * captureMenu = menuBar()->addMenu(tr("C&apture"));
+    QAction * snapshotAction = new QAction(tr("Save Snapshot (C)"), this);
+    connect(snapshotAction, &QAction::triggered, this, [this]() {
+        m_recorder.snapshot();
+    });
+    captureMenu->addAction(snapshotAction);
+    captureTriggerAction = new QAction(tr("Save on Trigger"), this);
+    captureTriggerAction->setCheckable(true);
+    connect(captureTriggerAction, &QAction::toggled, this, &Window::captureChanged);
+    captureMenu->addAction(captureTriggerAction);
+    recordAction = new QAction(tr("Record"), this);
+    recordAction->setCheckable(true);
+    connect(recordAction, &QAction::toggled, this, &Window::captureChanged);
+    captureMenu->addAction(recordAction);
+    // the writer reports from its own thread
+    m_recorder.setStatusSink([this](const QString & status) {
+        QMetaObject::invokeMethod(this, [this, status]() {
+            setWindowTitle(status);
+        }, Qt::QueuedConnection);
+    });
 
     window->setLayout(m_layout);
 
     setCentralWidget(window);
     window->show();
-    analytic_scope = new AnalyticScope(m_canvas);
-    spectrum_scope = new SpectrumScope(m_canvas);
-    active_scope = analytic_scope;
+    active_scope = scopeFor(hilbertScanAction);
     m_canvas->image() = active_scope;
 
     
-    timerConnection = connect(m_timer, &QTimer::timeout, m_canvas,[this](){
-        m_canvas->update();
-    });
+    connect(m_pacer, &FramePacer::present, m_canvas, &RasterView::refresh);
     
     resizeTimer = new QTimer(this);
     
     connect(this, &Window::resized, m_canvas, &RasterView::postResize);
     connect(resizeTimer, &QTimer::timeout, this, &Window::resizeTimeout);
+    connect(m_splitter, &QSplitter::splitterMoved, this, [this](int, int) {
+        resizeTimer->start(RESIZE_TIMEOUT);
+    });
+    m_statsTimer = new QTimer(this);
+    connect(m_statsTimer, &QTimer::timeout, this, &Window::reportStats);
     QApplication::instance()->installEventFilter(this);
-    m_timer->start(1000/refresh_rate);
-    active_scope->start();
-    initializeAudio(defaultDeviceInfo);
+    layoutPanes();
+    deviceChanged(defaultDeviceInfo);
 }
 
-void Window::initializeAudio(const QAudioDeviceInfo &deviceInfo)
+// Stops the scopes and lets the source go, device, file or port with it.
+void Window::closeSource()
 {
-    QAudioFormat format;
-    format.setSampleRate(SAMPLE_RATE);
-    format.setChannelCount(1);
-    format.setSampleSize(16);
-    format.setSampleType(QAudioFormat::SignedInt);
-    format.setByteOrder(QAudioFormat::LittleEndian);
-    format.setCodec("audio/pcm");
+    for(RasterImage * scope : m_attached)
+        scope->stop();
+    m_source.reset();
+    m_audioInfo.reset();
+}
 
-    if (!deviceInfo.isFormatSupported(format)) {
-        qWarning() << "Default format not supported - trying to use nearest";
-        format = deviceInfo.nearestFormat(format);
+// Swaps the source `make` builds in for whatever was feeding the scopes.
+// The old one is let go first, so one reopened on the same device or
+// port in a new format can have it; if the new one won't open, the old
+// one is built again. The scopes and the recorder take up the new format
+// before the first block arrives.
+bool Window::openSource(const std::function<SampleSource *()> & make)
+{
+    closeSource();
+    QScopedPointer<SampleSource> next(make());
+    QString error;
+    if(!next->open()) {
+        qWarning() << "Cannot open" << next->name() << "-" << next->errorString();
+        error = QString("[%1: %2]").arg(next->name()).arg(next->errorString());
+        // a reopen goes back in reopenSource()
+        if(!m_makeSource || &make == &m_makeSource) {
+            setWindowTitle(error);
+            return false;
+        }
+        next.reset(m_makeSource());
+        if(!next->open()) {
+            setWindowTitle(error);
+            return false;
+        }
+    } else {
+        m_makeSource = make;
     }
+    m_source.reset(next.take());
+    m_captureFormat = m_source->format();
+    for(RasterImage * scope : {(RasterImage *) analytic_scope, (RasterImage *) spectrum_scope, (RasterImage *) xy_scope})
+        if(scope != nullptr)
+            scope->setFormat(m_captureFormat);
+
+    m_recorder.setFormat(m_captureFormat);
+    m_audioInfo.reset(new AudioInfo(m_captureFormat, &m_recorder));
+    for(RasterImage * scope : m_attached)
+        m_audioInfo->addSink(scope);
+
+    // Sources push straight into AudioInfo::write, which appends to each
+    // shown scope's ring without any copies of its own.
+    AudioInfo * info = m_audioInfo.data();
+    // a replay or pipe that ends, or a port lost, reports from the source's thread
+    m_source->setStatusSink([this](const QString & status) {
+        QMetaObject::invokeMethod(this, [this, status]() {
+            setWindowTitle(status);
+        }, Qt::QueuedConnection);
+    });
+    m_source->start([info](const char * bytes, quint32 frames) {
+        info->write(bytes, frames);
+    });
+    if(m_paused || m_idle) {
+        m_source->suspend();
+    } else {
+        for(RasterImage * scope : m_attached)
+            scope->start();
+    }
+    setWindowTitle(error.isEmpty() ? m_source->name() : error);
+    return error.isEmpty();
+}
 
-    m_audioInfo.reset(new AudioInfo(format));
-    audioUpdateConnection = connect(m_audioInfo.data(), &AudioInfo::update, [this]() {
-        m_canvas->setData(m_audioInfo->dataFrame(), m_audioInfo->dataLen());
+// The same source again with `channels` and `rate`; if it won't take
+// them it goes back to what it had, keeping the error in the title.
+void Window::reopenSource(int channels, int rate)
+{
+    const int wasChannels = m_channels;
+    const int wasRate = m_rate;
+    m_channels = channels;
+    m_rate = rate;
+    if(!m_makeSource || openSource(m_makeSource))
+        return;
+    const QString error = windowTitle();
+    m_channels = wasChannels;
+    m_rate = wasRate;
+    if(openSource(m_makeSource))
+        setWindowTitle(error);
+}
+
+void Window::replayFile(const QString & path, bool fast)
+{
+    openSource([path, fast]() -> SampleSource * {
+        return new FileSource(path, fast);
     });
+}
 
-    m_audioInput.reset(new QAudioInput(deviceInfo, format));
-    m_audioInfo->start();
-    auto io = m_audioInput->start();
-    connect(io, &QIODevice::readyRead,
-        [&, io]() {
-            
-            qint64 len = m_audioInput->bytesReady();
-            const int BufferSize = FRAME_SIZE;
-            if (len > BufferSize)
-                len = BufferSize;
-
-            QByteArray buffer(len, 0);
-            qint64 l = io->read(buffer.data(), len);
-            if (l > 0)
-                m_audioInfo->write(buffer.constData(), l);
-        });
+void Window::readStdin()
+{
+    openSource([this]() -> SampleSource * {
+        return new StdinSource(m_channels, m_rate);
+    });
+}
+
+void Window::listen(NetworkSource::Protocol protocol, quint16 port)
+{
+    openSource([this, protocol, port]() -> SampleSource * {
+        return new NetworkSource(protocol, port, m_channels, m_rate);
+    });
+}
+
+RasterImage * Window::scopeFor(const QAction * view)
+{
+    auto title = [this](const QString & t) { setWindowTitle(t); };
+    FramePacer * pacer = m_pacer;
+    auto frame = [pacer]() { pacer->frameReady(); };
+    if(view == spectrumAction) {
+        if(spectrum_scope == nullptr) {
+            spectrum_scope = new SpectrumScope(m_canvas);
+            spectrum_scope->setTitleSink(title);
+            spectrum_scope->setFrameSink(frame);
+            spectrum_scope->setFormat(m_captureFormat);
+            spectrum_scope->setTriggerEdge(m_triggerEdge);
+            spectrum_scope->setTriggerMode(m_triggerMode);
+        }
+        return spectrum_scope;
+    }
+    if(view == xyAction) {
+        if(xy_scope == nullptr) {
+            xy_scope = new XYScope(m_canvas);
+            xy_scope->setTitleSink(title);
+            xy_scope->setFrameSink(frame);
+            xy_scope->setFormat(m_captureFormat);
+        }
+        return xy_scope;
+    }
+    if(analytic_scope == nullptr) {
+        analytic_scope = new AnalyticScope(m_canvas);
+        analytic_scope->setTitleSink(title);
+        analytic_scope->setFrameSink(frame);
+        analytic_scope->setFormat(m_captureFormat);
+        analytic_scope->setPerChannel(perChannelAction->isChecked());
+        analytic_scope->setTriggerEdge(m_triggerEdge);
+        analytic_scope->setTriggerMode(m_triggerMode);
+    }
+    return analytic_scope;
 }
 
 void Window::viewChanged(bool)
@@ -268,48 +619,294 @@ void Window::viewChanged(bool)
         la = dynamic_cast<QAction *>(sender());
     }
     if(la != NULL) {
-        m_audioInput->suspend();
-        active_scope->stop();
-        if(la==hilbertScanAction)
-            active_scope = analytic_scope;
-        else if(la == spectrumAction)
-            active_scope = spectrum_scope;
+        active_scope = scopeFor(la);
         m_canvas->image() = active_scope;
-        active_scope->start();
+        layoutPanes();
+        m_canvas->update();
+        resetStats();
         m_canvas->postResize();
-        m_audioInput->resume();
+    }
+}
+
+QVector<RasterImage *> Window::shownScopes()
+{
+    QVector<RasterImage *> shown;
+    shown.append(active_scope);
+    if(splitAction->isChecked())
+        for(const QAction * view : {hilbertScanAction, spectrumAction, xyAction})
+            if(scopeFor(view) != active_scope)
+                shown.append(scopeFor(view));
+    return shown;
+}
+
+// Joins `scope` to the capture fan-out. Its ring is reset before the
+// producer can see it, and its worker runs alongside the others.
+void Window::attach(RasterImage * scope)
+{
+    if(!m_paused)
+        scope->start();
+    if(!m_audioInfo.isNull())
+        m_audioInfo->addSink(scope);
+    m_attached.append(scope);
+}
+
+void Window::detach(RasterImage * scope)
+{
+    if(!m_audioInfo.isNull())
+        m_audioInfo->removeSink(scope);
+    scope->stop();
+    m_attached.removeAll(scope);
+}
+
+// Brings the panes and the fan-out in line with the view menu. Scopes
+// staying on screen keep running, and capture never stops.
+void Window::layoutPanes()
+{
+    const QVector<RasterImage *> shown = shownScopes();
+    for(RasterImage * scope : QVector<RasterImage *>(m_attached))
+        if(!shown.contains(scope))
+            detach(scope);
+    for(RasterImage * scope : shown)
+        if(!m_attached.contains(scope))
+            attach(scope);
+
+    for(RasterView * pane : m_panes)
+        delete pane;
+    m_panes.clear();
+    for(int i = 1; i < shown.size(); i++) {
+        RasterView * pane = new RasterView(this);
+        pane->image() = shown[i];
+        connect(m_pacer, &FramePacer::present, pane, &RasterView::refresh);
+        connect(this, &Window::resized, pane, &RasterView::postResize);
+        m_splitter->addWidget(pane);
+        m_panes.append(pane);
+    }
+    resizeTimer->start(RESIZE_TIMEOUT);
+}
+
+// Stats are recorded only while someone is looking at them.
+void Window::updateStats()
+{
+    bool on = m_canvas->hudShown() || m_statsOutput;
+    ScopeStats::setEnabled(on);
+    if(on && !m_statsTimer->isActive()) {
+        resetStats();
+        m_statsTimer->start(1000);
+    } else if(!on) {
+        m_statsTimer->stop();
+        m_canvas->setHudLines(QStringList());
+    }
+}
+
+// The shown scope's counters, the source's and the capture side's.
+ScopeStats::Totals Window::stats() const
+{
+    ScopeStats::Totals t = active_scope->stats();
+    if(!m_source.isNull()) {
+        t.packetsLost = m_source->packetsLost();
+        t.packetsLate = m_source->packetsLate();
+    }
+    if(!m_audioInfo.isNull()) {
+        t.ingestNs = m_audioInfo->ingestNs();
+        t.ingested = m_audioInfo->ingested();
+    }
+    return t;
+}
+
+void Window::reportStats()
+{
+    ScopeStats::Totals now = stats();
+    qint64 t = ScopeStats::now();
+    ScopeStats::Totals d = now.since(m_lastStats);
+    qint64 interval = t - m_lastStatsTime;
+    m_lastStats = now;
+    m_lastStatsTime = t;
+
+    if(m_canvas->hudShown())
+        m_canvas->setHudLines(d.hud(interval));
+    if(m_statsOutput) {
+        fprintf(stderr, "%s\n", qPrintable(d.json(interval)));
+        fflush(stderr);
     }
 }
 
 void Window::toggleSuspend()
 {
-    if (m_audioInput->state() == QAudio::SuspendedState || m_audioInput->state() == QAudio::StoppedState) {
-        active_scope->start();
-        m_audioInput->resume();
-    } else if (m_audioInput->state() == QAudio::ActiveState) {
-        active_scope->stop();
-        m_audioInput->suspend();
+    m_paused = !m_paused;
+    if(!m_idle)
+        runScope(!m_paused);
+}
+
+// Suspended, the worker sleeps on its semaphore and, with no frames
+// published, the pacer schedules nothing.
+void Window::runScope(bool run)
+{
+    if(m_source.isNull())
+        return;
+    if(run) {
+        for(RasterImage * scope : m_attached)
+            scope->start();
+        m_source->resume();
+    } else {
+        m_source->suspend();
+        for(RasterImage * scope : m_attached)
+            scope->stop();
+    }
+}
+
+void Window::setIdle(bool idle)
+{
+    if(idle == m_idle)
+        return;
+    m_idle = idle;
+    m_pacer->setPaused(idle);
+    if(!idle) {
+        updateDisplayFps();
+        m_canvas->update();
+    }
+    if(!m_paused)
+        runScope(!idle);
+}
+
+void Window::setTargetFps(int fps)
+{
+    if(fps <= 0)
+        return;
+    m_pacer->setTargetFps(fps);
+    for(QAction * a : m_fpsGroup->actions())
+        a->setChecked(a->data().toInt() == fps);
+}
+
+// Repaints are capped to the refresh rate of the screen the window is on.
+void Window::updateDisplayFps()
+{
+    QWindow * handle = windowHandle();
+    if(handle == nullptr || handle->screen() == nullptr)
+        return;
+    m_pacer->setDisplayFps(handle->screen()->refreshRate());
+    if(!m_screenChanged)
+        m_screenChanged = connect(handle, &QWindow::screenChanged, this, [this](QScreen *) {
+            updateDisplayFps();
+        });
+}
+
+void Window::channelsChanged(int channels)
+{
+    reopenSource(channels, m_rate);
+}
+
+void Window::triggerChanged()
+{
+    if(analytic_scope != nullptr) {
+        analytic_scope->setTriggerEdge(m_triggerEdge);
+        analytic_scope->setTriggerMode(m_triggerMode);
+    }
+    if(spectrum_scope != nullptr) {
+        spectrum_scope->setTriggerEdge(m_triggerEdge);
+        spectrum_scope->setTriggerMode(m_triggerMode);
     }
+    captureChanged();
+}
+
+void Window::captureChanged()
+{
+    CaptureRecorder::Params p = m_recorder.params();
+    p.onTrigger = captureTriggerAction->isChecked();
+    p.recording = recordAction->isChecked();
+    p.edge = m_triggerEdge;
+    m_recorder.setParams(p);
+}
+
+void Window::setCaptureDir(const QString & dir)
+{
+    CaptureRecorder::Params p = m_recorder.params();
+    p.dir = dir;
+    m_recorder.setParams(p);
+}
+
+void Window::setCaptureLevel(qreal level)
+{
+    CaptureRecorder::Params p = m_recorder.params();
+    p.level = level;
+    m_recorder.setParams(p);
+}
+
+void Window::rearmTrigger()
+{
+    if(analytic_scope != nullptr)
+        analytic_scope->rearmTrigger();
+    if(spectrum_scope != nullptr)
+        spectrum_scope->rearmTrigger();
+}
+
+void Window::setSampleRate(int rate)
+{
+    if(rate <= 0 || rate == m_rate)
+        return;
+    reopenSource(m_channels, rate);
 }
 
 void Window::deviceChanged(const QAudioDeviceInfo & device)
 {
-    active_scope->stop();
-    m_audioInfo->stop();
-    m_audioInput->stop();
-    m_audioInput->disconnect(this);
-    initializeAudio(device);
-    active_scope->start();
+    openSource([this, device]() -> SampleSource * {
+        return new DeviceSource(device, m_channels, m_rate);
+    });
 }
 
 int main(int argc, char **argv)
 {
-    QApplication app(argc, argv);
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--render") == 0) {
+            // headless: no display, no audio device
+            QCoreApplication app(argc, argv);
+            fftwInit();
+            int ret = renderOffline(app.arguments());
+            fftwSaveWisdom();
+            fftwCleanup();
+            return ret;
+        }
+    }
 
-    Window window;
-    window.resize(INIT_SIZE, INIT_SIZE);
-    window.show();
-    return app.exec();
+    QApplication app(argc, argv);
+    fftwInit();
+
+    // The window, its scopes and its source hold FFTW plans; they all go
+    // before FFTW is cleaned up.
+    int ret;
+    {
+        Window window;
+        window.setStatsOutput(app.arguments().contains("--stats"));
+        const int fpsArg = app.arguments().indexOf("--fps");
+        if(fpsArg > 0 && fpsArg + 1 < app.arguments().size())
+            window.setTargetFps(app.arguments().at(fpsArg + 1).toInt());
+        const int rateArg = app.arguments().indexOf("--rate");
+        if(rateArg > 0 && rateArg + 1 < app.arguments().size())
+            window.setSampleRate(app.arguments().at(rateArg + 1).toInt());
+        const int captureDirArg = app.arguments().indexOf("--capture-dir");
+        if(captureDirArg > 0 && captureDirArg + 1 < app.arguments().size())
+            window.setCaptureDir(app.arguments().at(captureDirArg + 1));
+        const int captureLevelArg = app.arguments().indexOf("--capture-level");
+        if(captureLevelArg > 0 && captureLevelArg + 1 < app.arguments().size())
+            window.setCaptureLevel(app.arguments().at(captureLevelArg + 1).toDouble());
+        // input other than the default audio device
+        const int replayArg = app.arguments().indexOf("--replay");
+        const int udpArg = app.arguments().indexOf("--udp");
+        const int tcpArg = app.arguments().indexOf("--tcp");
+        if(replayArg > 0 && replayArg + 1 < app.arguments().size())
+            window.replayFile(app.arguments().at(replayArg + 1), app.arguments().contains("--fast"));
+        else if(app.arguments().contains("--stdin"))
+            window.readStdin();
+        else if(udpArg > 0 && udpArg + 1 < app.arguments().size())
+            window.listen(NetworkSource::Udp, app.arguments().at(udpArg + 1).toInt());
+        else if(tcpArg > 0 && tcpArg + 1 < app.arguments().size())
+            window.listen(NetworkSource::Tcp, app.arguments().at(tcpArg + 1).toInt());
+        window.resize(INIT_SIZE, INIT_SIZE);
+        window.show();
+        ret = app.exec();
+    }
+    fftwSaveWisdom();
+    fftwCleanup();
+    return ret;
 }
 
 
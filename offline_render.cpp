@@ -0,0 +1,227 @@
+//
+//  offline_render.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFuture>
+#include <QScopedPointer>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <cstdio>
+#include "offline_render.hpp"
+#include "pcm_file.hpp"
+#include "analytic_scope.hpp"
+#include "spectrum_scope.hpp"
+#include "xy_scope.hpp"
+
+struct RenderSetup {
+    QString scope;
+    QSize size;
+    QString dir;            // empty for raw frames on stdout
+    const scope_real * samples;    // planar, one channel after another
+    qint64 stride;          // samples per channel
+    int channels;
+    quint32 rate;
+    quint32 len;            // the scope's frame size at `rate`
+    quint32 hop;
+};
+
+static RasterImage * makeScope(const QString & name)
+{
+    if(name == "spectrum")
+        return new SpectrumScope(nullptr);
+    if(name == "xy")
+        return new XYScope(nullptr);
+    return new AnalyticScope(nullptr);
+}
+
+struct RenderedChunk {
+    QVector<QByteArray> raw;    // for in-order output on stdout
+    QString error;              // the PNG that couldn't be written, if any
+};
+
+// Renders frames [first, first+count) on a scope of its own. PNGs are
+// written as they're made, and the chunk stops at the first that can't
+// be; raw frames come back for in-order output.
+static RenderedChunk renderChunk(const RenderSetup & s, qint64 first, qint64 count)
+{
+    QScopedPointer<RasterImage> scope(makeScope(s.scope));
+    SampleFormat format;
+    format.channels = s.channels;
+    format.rate = s.rate;
+    scope->setFormat(format);
+    scope->resize(s.size);
+    const qint64 warm = qMin(first, (qint64) scope->historyFrames());
+
+    RenderedChunk chunk;
+    for(qint64 f = first - warm; f < first + count; f++) {
+        scope->render(s.samples + f*s.hop, s.stride);
+        if(f < first)
+            continue;
+        if(!s.dir.isEmpty()) {
+            const QString path = QString("%1/frame_%2.png").arg(s.dir).arg(f, 6, 10, QChar('0'));
+            if(!scope->save(path, "PNG")) {
+                chunk.error = path;
+                break;
+            }
+        } else {
+            // scopes render RGB32; the raw stream stays packed RGB24
+            QByteArray frame(scope->width() * scope->height() * 3, Qt::Uninitialized);
+            uchar * out = reinterpret_cast<uchar *>(frame.data());
+            for(int y = 0; y < scope->height(); y++) {
+                const QRgb * line = reinterpret_cast<const QRgb *>(scope->constScanLine(y));
+                for(int x = 0; x < scope->width(); x++) {
+                    *out++ = qRed(line[x]);
+                    *out++ = qGreen(line[x]);
+                    *out++ = qBlue(line[x]);
+                }
+            }
+            chunk.raw.append(frame);
+        }
+    }
+    return chunk;
+}
+
+int renderOffline(const QStringList & arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Render a recording through a scope, without display or audio.");
+    parser.addHelpOption();
+    QCommandLineOption renderOption("render", "WAV (16/24/32-bit or float) or raw s16le mono file to render.", "file");
+    QCommandLineOption scopeOption("scope", "analytic, spectrum or xy.", "name", "analytic");
+    QCommandLineOption sizeOption("size", "Frame size.", "WxH",
+                                  QString("%1x%1").arg(INIT_SIZE/PIXEL_SCALE));
+    QCommandLineOption outputOption("output", "Directory for PNG frames, or - for raw RGB24 on stdout.",
+                                    "path", ".");
+    QCommandLineOption jobsOption("jobs", "Chunks rendered in parallel.", "n",
+                                  QString::number(QThread::idealThreadCount()));
+    parser.addOption(renderOption);
+    parser.addOption(scopeOption);
+    parser.addOption(sizeOption);
+    parser.addOption(outputOption);
+    parser.addOption(jobsOption);
+    parser.process(arguments);
+
+    RenderSetup s;
+    s.scope = parser.value(scopeOption);
+    if(s.scope != "analytic" && s.scope != "spectrum" && s.scope != "xy") {
+        fprintf(stderr, "unknown scope %s\n", qPrintable(s.scope));
+        return 1;
+    }
+    QStringList wh = parser.value(sizeOption).split("x");
+    s.size = QSize(wh.value(0).toInt(), wh.value(1).toInt());
+    if(s.size.width() <= 0 || s.size.height() <= 0) {
+        fprintf(stderr, "bad --size %s\n", qPrintable(parser.value(sizeOption)));
+        return 1;
+    }
+    if(parser.value(outputOption) != "-") {
+        s.dir = parser.value(outputOption);
+        if(!QDir().mkpath(s.dir)) {
+            fprintf(stderr, "cannot create %s\n", qPrintable(s.dir));
+            return 1;
+        }
+    }
+    const int jobs = qMax(1, parser.value(jobsOption).toInt());
+
+    PcmFile file;
+    if(!file.open(parser.value(renderOption))) {
+        fprintf(stderr, "%s: %s\n", qPrintable(parser.value(renderOption)), qPrintable(file.errorString()));
+        return 1;
+    }
+    // The XY scope plots channels against each other, so it takes them as
+    // they are; the others render the file's mono mix.
+    QVector<QVector<scope_real> > planes;
+    if(s.scope == "xy") {
+        const SampleFormat & format = file.format();
+        QByteArray block(BASE_FRAME_SIZE * format.bytesPerFrame(), Qt::Uninitialized);
+        QVector<scope_real> interleaved(BASE_FRAME_SIZE * format.channels);
+        planes.resize(format.channels);
+        qint64 got;
+        while((got = file.readFrames(block.data(), BASE_FRAME_SIZE)) > 0) {
+            ingest(block.constData(), got * format.channels, format, interleaved.data());
+            for(int c = 0; c < format.channels; c++)
+                for(qint64 i = 0; i < got; i++)
+                    planes[c].append(interleaved[i * format.channels + c]);
+        }
+    } else {
+        planes.resize(1);
+        QVector<scope_real> & mono = planes[0];
+        qint64 got;
+        do {
+            qint64 at = mono.size();
+            mono.resize(at + BASE_FRAME_SIZE*16);
+            got = file.read(mono.data() + at, BASE_FRAME_SIZE*16);
+            mono.resize(at + got);
+        } while(got > 0);
+    }
+    QVector<scope_real> samples = planes[0];
+    for(int c = 1; c < planes.size(); c++)
+        samples += planes[c];
+
+    s.samples = samples.constData();
+    s.channels = planes.size();
+    s.stride = planes[0].size();
+    // frames are sized to the file's rate, as they would be to a device's
+    s.rate = file.sampleRate();
+    s.len = RasterImage::frameSizeFor(s.rate);
+    s.hop = s.len / 2;
+    const qint64 frames = s.stride < s.len ? 0 : (s.stride - s.len) / s.hop + 1;
+    const qint64 chunks = (frames + RENDER_CHUNK_FRAMES - 1) / RENDER_CHUNK_FRAMES;
+
+    // parallelism comes from the chunks, not from inside each FFT
+    FFTW<scope_real>::plan_with_nthreads(1);
+    QThreadPool::globalInstance()->setMaxThreadCount(jobs);
+
+    QFile out;
+    if(s.dir.isEmpty() && !out.open(stdout, QIODevice::WriteOnly)) {
+        fprintf(stderr, "cannot write stdout\n");
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Keep `jobs` chunks in flight and drain them in order. After a failed
+    // write no more are started, but those in flight still read `samples`
+    // and are waited out.
+    QList<QFuture<RenderedChunk> > inflight;
+    QString error;
+    qint64 next = 0;
+    for(qint64 c = 0; c < chunks; c++) {
+        for(; error.isEmpty() && next < chunks && next < c + jobs; next++) {
+            qint64 first = next * RENDER_CHUNK_FRAMES;
+            qint64 count = qMin((qint64) RENDER_CHUNK_FRAMES, frames - first);
+            inflight.append(QtConcurrent::run([s, first, count]() {
+                return renderChunk(s, first, count);
+            }));
+        }
+        if(inflight.isEmpty())
+            break;
+        const RenderedChunk chunk = inflight.takeFirst().result();
+        if(!error.isEmpty())
+            continue;
+        if(!chunk.error.isEmpty())
+            error = chunk.error;
+        for(const QByteArray & frame : chunk.raw)
+            if(error.isEmpty() && out.write(frame.constData(), frame.size()) != frame.size())
+                error = "stdout";
+    }
+    if(out.isOpen() && error.isEmpty() && !out.flush())
+        error = "stdout";
+    out.close();
+    if(!error.isEmpty()) {
+        fprintf(stderr, "cannot write %s\n", qPrintable(error));
+        return 1;
+    }
+
+    const double secs = timer.elapsed() / 1000.0;
+    fprintf(stderr, "%lld frames (%.1f s of audio) in %.1f s\n", (long long) frames,
+            (double) s.stride / s.rate, secs);
+    return 0;
+}
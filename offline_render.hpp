@@ -0,0 +1,28 @@
+//
+//  offline_render.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef offline_render_hpp
+#define offline_render_hpp
+
+#include <QStringList>
+
+// frames per parallel job; raw output holds up to jobs*chunk frames
+#define RENDER_CHUNK_FRAMES 128
+
+// `xyscope --render <file> [options]`: runs a recording through a scope
+// without a display or audio device, writing PNG frames to a directory
+// or raw RGB24 frames to stdout. Returns the process exit code. The XY
+// scope gets the file's channels as recorded; the others get its mono
+// mix.
+//
+// The recording is cut into chunks that render in parallel, each on its
+// own scope. A chunk first renders historyFrames() frames before its start
+// and throws them away so fades and scan planes are already built up;
+// the seams match a continuous render to within that history's rounding.
+int renderOffline(const QStringList & arguments);
+
+#endif /* offline_render_hpp */
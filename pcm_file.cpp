@@ -0,0 +1,120 @@
+//
+//  pcm_file.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <QtEndian>
+#include <cstring>
+#include "pcm_file.hpp"
+#include "raster_image.hpp"
+
+bool PcmFile::open(const QString & path)
+{
+    m_rate = DEFAULT_SAMPLE_RATE;
+    m_format = SampleFormat();
+    m_dataLeft = -1;
+    m_file.setFileName(path);
+    if(!m_file.open(QIODevice::ReadOnly)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    return readHeader();
+}
+
+// Walks the RIFF chunks up to "data", keeping what "fmt " says. Anything
+// that doesn't start with a RIFF/WAVE header is taken as raw s16le.
+bool PcmFile::readHeader()
+{
+    char riff[12];
+    if(m_file.read(riff, 12) != 12
+       || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        m_file.seek(0);
+        return true;
+    }
+
+    bool haveFormat = false;
+    char chunk[8];
+    while(m_file.read(chunk, 8) == 8) {
+        quint32 size = qFromLittleEndian<quint32>(chunk + 4);
+        // chunks are padded to even sizes
+        const quint32 pad = size & 1;
+        if(memcmp(chunk, "fmt ", 4) == 0) {
+            // WAVE_FORMAT_EXTENSIBLE's subformat GUID ends at byte 40
+            char fmt[40];
+            const quint32 got = qMin(size, (quint32) sizeof(fmt));
+            if(got < 16 || m_file.read(fmt, got) != got)
+                break;
+            quint16 tag = qFromLittleEndian<quint16>(fmt);
+            m_format.channels = qFromLittleEndian<quint16>(fmt + 2);
+            m_rate = qFromLittleEndian<quint32>(fmt + 4);
+            quint16 bits = qFromLittleEndian<quint16>(fmt + 14);
+            // 0xFFFE is WAVE_FORMAT_EXTENSIBLE, the real tag leads the GUID
+            if(tag == 0xFFFE && got >= 40)
+                tag = qFromLittleEndian<quint16>(fmt + 24);
+            // 1 is integer PCM, 3 IEEE float
+            if(tag == 1 && bits == 16)
+                m_format.encoding = SampleFormat::S16;
+            else if(tag == 1 && bits == 24)
+                m_format.encoding = SampleFormat::S24;
+            else if(tag == 1 && bits == 32)
+                m_format.encoding = SampleFormat::S32;
+            else if(tag == 3 && bits == 32)
+                m_format.encoding = SampleFormat::F32;
+            else
+                tag = 0;
+            if(tag == 0 || m_format.channels == 0) {
+                m_error = QString("unsupported WAV format (tag %1, %2 bits)").arg(qFromLittleEndian<quint16>(fmt)).arg(bits);
+                return false;
+            }
+            haveFormat = true;
+            size -= got;
+        } else if(memcmp(chunk, "data", 4) == 0) {
+            if(!haveFormat)
+                break;
+            m_dataLeft = size;
+            return true;
+        }
+        if(!m_file.seek(m_file.pos() + size + pad))
+            break;
+    }
+    m_error = "malformed WAV file";
+    return false;
+}
+
+qint64 PcmFile::readFrames(char * bytes, qint64 len)
+{
+    qint64 want = len * m_format.bytesPerFrame();
+    if(m_dataLeft >= 0)
+        want = qMin(want, m_dataLeft);
+    const qint64 got = m_file.read(bytes, want);
+    if(got <= 0)
+        return 0;
+    if(m_dataLeft >= 0)
+        m_dataLeft -= got;
+    return got / m_format.bytesPerFrame();
+}
+
+qint64 PcmFile::read(scope_real * mono, qint64 len)
+{
+    const int channels = m_format.channels;
+    m_bytes.resize(len * m_format.bytesPerFrame());
+    const qint64 frames = readFrames(m_bytes.data(), len);
+    if(frames == 0)
+        return 0;
+    if(channels == 1) {
+        ingest(m_bytes.constData(), frames, m_format, mono);
+        return frames;
+    }
+    m_scratch.resize(frames * channels);
+    ingest(m_bytes.constData(), frames * channels, m_format, m_scratch.data());
+    const scope_real * in = m_scratch.constData();
+    for(qint64 n = 0; n < frames; n++) {
+        scope_real sum = 0;
+        for(int c = 0; c < channels; c++)
+            sum += in[n*channels + c];
+        mono[n] = sum / channels;
+    }
+    return frames;
+}
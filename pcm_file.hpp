@@ -0,0 +1,49 @@
+//
+//  pcm_file.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef pcm_file_hpp
+#define pcm_file_hpp
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include "sample_ingest.hpp"
+
+// Recorded input for headless renders and replay: 16/24/32-bit integer
+// or 32-bit float PCM from a RIFF/WAVE file, or headerless s16le mono at
+// DEFAULT_SAMPLE_RATE when there is no RIFF header. Samples go through
+// the same ingest as live capture; read() averages multi-channel files
+// down to mono.
+class PcmFile {
+public:
+    bool open(const QString & path);
+    QString errorString() const {return m_error;}
+
+    quint32 sampleRate() const {return m_rate;}
+    quint16 channels() const   {return m_format.channels;}
+    const SampleFormat & format() const {return m_format;}
+
+    // reads up to len mono samples, returns how many were read (0 at end)
+    qint64 read(scope_real * mono, qint64 len);
+    // reads up to len frames as stored, in format(); returns how many
+    // were read (0 at end)
+    qint64 readFrames(char * bytes, qint64 len);
+
+private:
+    bool readHeader();
+
+    QFile m_file;
+    QString m_error;
+    quint32 m_rate;
+    SampleFormat m_format;
+    qint64 m_dataLeft = -1;     // bytes of sample data left, -1 to EOF
+    QByteArray m_bytes;
+    QVector<scope_real> m_scratch;
+};
+
+#endif /* pcm_file_hpp */
@@ -0,0 +1,263 @@
+//
+//  phosphor.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <cstring>
+#include <qmath.h>
+#include <QtConcurrent>
+#include "phosphor.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define PHOSPHOR_X86 1
+#endif
+
+namespace {
+
+// x/(1+x) of the scaled intensity, to 0..255 with rounding
+inline quint32 toneScalar(float v)
+{
+    float x = v * PHOSPHOR_GAIN;
+    return (quint32) (x / (1.0f + x) * 255.0f + 0.5f);
+}
+
+void decayScalar(float * p, int n, float f, int from)
+{
+    for(int i = from; i < n; i++)
+        p[i] *= f;
+}
+
+void toneScalar(const float * r, const float * g, const float * b, int n, QRgb * out, int from)
+{
+    for(int i = from; i < n; i++)
+        out[i] = 0xff000000u | toneScalar(r[i]) << 16 | toneScalar(g[i]) << 8 | toneScalar(b[i]);
+}
+
+#ifdef PHOSPHOR_X86
+
+#ifdef __SSE2__
+void decaySse2(float * p, int n, float f)
+{
+    const __m128 k = _mm_set1_ps(f);
+    int i = 0;
+    for(; i + 4 <= n; i += 4)
+        _mm_storeu_ps(p + i, _mm_mul_ps(_mm_loadu_ps(p + i), k));
+    decayScalar(p, n, f, i);
+}
+
+inline __m128i tone4(__m128 v)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 x = _mm_mul_ps(v, _mm_set1_ps(PHOSPHOR_GAIN));
+    __m128 y = _mm_div_ps(_mm_mul_ps(x, _mm_set1_ps(255.0f)), _mm_add_ps(one, x));
+    return _mm_cvttps_epi32(_mm_add_ps(y, _mm_set1_ps(0.5f)));
+}
+
+void toneSse2(const float * r, const float * g, const float * b, int n, QRgb * out)
+{
+    const __m128i alpha = _mm_set1_epi32((int) 0xff000000u);
+    int i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m128i px = _mm_or_si128(_mm_slli_epi32(tone4(_mm_loadu_ps(r + i)), 16),
+                                  _mm_slli_epi32(tone4(_mm_loadu_ps(g + i)), 8));
+        px = _mm_or_si128(_mm_or_si128(px, tone4(_mm_loadu_ps(b + i))), alpha);
+        _mm_storeu_si128((__m128i *) (out + i), px);
+    }
+    toneScalar(r, g, b, n, out, i);
+}
+#endif
+
+__attribute__((target("avx2")))
+void decayAvx2(float * p, int n, float f)
+{
+    const __m256 k = _mm256_set1_ps(f);
+    int i = 0;
+    for(; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(p + i, _mm256_mul_ps(_mm256_loadu_ps(p + i), k));
+    decayScalar(p, n, f, i);
+}
+
+__attribute__((target("avx2")))
+inline __m256i tone8(__m256 v)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 x = _mm256_mul_ps(v, _mm256_set1_ps(PHOSPHOR_GAIN));
+    __m256 y = _mm256_div_ps(_mm256_mul_ps(x, _mm256_set1_ps(255.0f)), _mm256_add_ps(one, x));
+    return _mm256_cvttps_epi32(_mm256_add_ps(y, _mm256_set1_ps(0.5f)));
+}
+
+__attribute__((target("avx2")))
+void toneAvx2(const float * r, const float * g, const float * b, int n, QRgb * out)
+{
+    const __m256i alpha = _mm256_set1_epi32((int) 0xff000000u);
+    int i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m256i px = _mm256_or_si256(_mm256_slli_epi32(tone8(_mm256_loadu_ps(r + i)), 16),
+                                     _mm256_slli_epi32(tone8(_mm256_loadu_ps(g + i)), 8));
+        px = _mm256_or_si256(_mm256_or_si256(px, tone8(_mm256_loadu_ps(b + i))), alpha);
+        _mm256_storeu_si256((__m256i *) (out + i), px);
+    }
+    toneScalar(r, g, b, n, out, i);
+}
+
+#endif /* PHOSPHOR_X86 */
+
+typedef void (*DecayKernel)(float *, int, float);
+typedef void (*ToneKernel)(const float *, const float *, const float *, int, QRgb *);
+
+void decayPortable(float * p, int n, float f)
+{
+    decayScalar(p, n, f, 0);
+}
+
+void tonePortable(const float * r, const float * g, const float * b, int n, QRgb * out)
+{
+    toneScalar(r, g, b, n, out, 0);
+}
+
+struct Kernels {
+    DecayKernel decay;
+    ToneKernel tone;
+};
+
+Kernels selectKernels()
+{
+#ifdef PHOSPHOR_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return Kernels{decayAvx2, toneAvx2};
+#ifdef __SSE2__
+    return Kernels{decaySse2, toneSse2};
+#endif
+#endif
+    return Kernels{decayPortable, tonePortable};
+}
+
+const Kernels kernels = selectKernels();
+
+}
+
+Phosphor::Phosphor() : m_buckets(PHOSPHOR_BUCKETS)
+{
+    m_planes[0] = m_planes[1] = m_planes[2] = NULL;
+}
+
+Phosphor::~Phosphor()
+{
+    qFreeAligned(m_buf);
+}
+
+void Phosphor::resize(int width, int height)
+{
+    if(width == m_width && height == m_height)
+        return;
+    m_width = width;
+    m_height = height;
+    // rows start on a cache line
+    m_stride = (width + 15) & ~15;
+    const size_t plane = (size_t) m_stride * height;
+    qFreeAligned(m_buf);
+    m_buf = (float *) qMallocAligned(3 * plane * sizeof(float), 64);
+    memset(m_buf, 0, 3 * plane * sizeof(float));
+    for(int c = 0; c < 3; c++)
+        m_planes[c] = m_buf + c * plane;
+    m_buckets.fill(Bucket());
+    m_live = QRect();
+    m_cleared = true;
+}
+
+// PHOSPHOR_MAX takes log2(MAX * GAIN * 510) half-lives to tone map to 0
+qreal Phosphor::fadeTime(qreal halfLife)
+{
+    return halfLife * std::log2(PHOSPHOR_MAX * PHOSPHOR_GAIN * 510.0);
+}
+
+void Phosphor::decay(qreal dt, qreal halfLife)
+{
+    m_fadeNs = (qint64) (fadeTime(halfLife) * 1e9);
+    m_time += (qint64) (dt * 1e9);
+    if(m_live.isEmpty() || dt <= 0)
+        return;
+
+    const float f = (float) std::exp2(-dt / halfLife);
+    const QRect live = m_live;
+    forBands(live, [this, &live, f](int y0, int y1) {
+        for(int c = 0; c < 3; c++)
+            for(int y = y0; y < y1; y++)
+                kernels.decay(m_planes[c] + y*m_stride + live.left(), live.width(), f);
+    });
+}
+
+// Where hits may still be above black: every bucket of hits less than a
+// fade time (plus the bucket's own span) old.
+QRect Phosphor::track(const QRect & hits)
+{
+    const qint64 span = m_fadeNs / PHOSPHOR_BUCKETS;
+    if(m_time - m_buckets[m_bucket].start > span) {
+        m_bucket = (m_bucket + 1) % PHOSPHOR_BUCKETS;
+        m_buckets[m_bucket].start = m_time;
+        m_buckets[m_bucket].rect = QRect();
+    }
+    m_buckets[m_bucket].rect |= hits;
+
+    QRect live;
+    for(const Bucket & b : m_buckets)
+        if(m_time - b.start <= m_fadeNs + span)
+            live |= b.rect;
+    return live;
+}
+
+QRect Phosphor::present(QImage & image, const QRect & hits)
+{
+    const QRect live = track(hits) & QRect(0, 0, m_width, m_height);
+    const QRect span = m_cleared ? QRect(0, 0, m_width, m_height) : (live | m_live);
+    m_cleared = false;
+
+    // bits() detaches, so it is taken once here and not in the tasks
+    uchar * bits = image.bits();
+    const int bpl = image.bytesPerLine();
+    forBands(span, [this, bits, bpl, &span, &live](int y0, int y1) {
+        for(int y = y0; y < y1; y++) {
+            const int o = y*m_stride + span.left();
+            kernels.tone(m_planes[0] + o, m_planes[1] + o, m_planes[2] + o, span.width(),
+                         reinterpret_cast<QRgb *>(bits + y*bpl) + span.left());
+
+            // what just dropped out of the live region is below black;
+            // clear it so it can't build up again
+            int from = span.left(), to = span.right() + 1;
+            if(y >= live.top() && y <= live.bottom()) {
+                for(int c = 0; c < 3; c++) {
+                    memset(m_planes[c] + y*m_stride + from, 0, qMax(0, live.left() - from) * sizeof(float));
+                    if(live.right() + 1 < to)
+                        memset(m_planes[c] + y*m_stride + live.right() + 1, 0,
+                               (to - live.right() - 1) * sizeof(float));
+                }
+            } else {
+                for(int c = 0; c < 3; c++)
+                    memset(m_planes[c] + o, 0, (to - from) * sizeof(float));
+            }
+        }
+    });
+    m_live = live;
+    return span;
+}
+
+void Phosphor::forBands(const QRect & rect, const std::function<void(int, int)> & rows)
+{
+    if(rect.isEmpty())
+        return;
+    const int top = rect.top(), end = rect.bottom() + 1;
+    if(end - top <= PHOSPHOR_BAND) {
+        rows(top, end);
+        return;
+    }
+    m_bands.resize(0);
+    for(int y = top; y < end; y += PHOSPHOR_BAND)
+        m_bands.append(y);
+    QtConcurrent::blockingMap(m_bands, [&rows, end](int y0) {
+        rows(y0, qMin(y0 + PHOSPHOR_BAND, end));
+    });
+}
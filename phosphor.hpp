@@ -0,0 +1,81 @@
+//
+//  phosphor.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef phosphor_hpp
+#define phosphor_hpp
+
+#include <QImage>
+#include <QRect>
+#include <QVector>
+#include <functional>
+
+// ceiling on a plane's accumulated intensity, in single full-bright hits
+#define PHOSPHOR_MAX 64.0f
+// tone map: out = x/(1+x) with x = v*PHOSPHOR_GAIN, so one hit is 3/4 bright
+#define PHOSPHOR_GAIN 3.0f
+// rows per task in the decay and tone map passes
+#define PHOSPHOR_BAND 16
+// time buckets tracking where the phosphor is still lit
+#define PHOSPHOR_BUCKETS 16
+
+// Persistent phosphor behind a trace: one float plane per color channel
+// accumulates hits, decays exponentially with a half-life in seconds of
+// scope time, and is tone mapped into an RGB32 image. Decay and tone
+// mapping are vector kernels run over bands of rows in parallel, and both
+// only touch the region that can still be lit.
+//
+// Owned by the thread rendering the scope.
+class Phosphor {
+public:
+    Phosphor();
+    ~Phosphor();
+
+    // Clears to black; the next present() rewrites the whole image.
+    void resize(int width, int height);
+    int width() const  {return m_width;}
+    int height() const {return m_height;}
+
+    // Ages the phosphor by `dt` seconds.
+    void decay(qreal dt, qreal halfLife);
+    // seconds for the brightest possible pixel to fade to black
+    static qreal fadeTime(qreal halfLife);
+
+    // Planes for accumulating hits, R, G and B, `stride()` floats a row.
+    float * plane(int c) {return m_planes[c];}
+    int stride() const {return m_stride;}
+
+    // Tone maps into `image` (Format_RGB32, same size) after hits inside
+    // `hits` were added. Returns the part of the image that changed.
+    QRect present(QImage & image, const QRect & hits);
+
+private:
+    Phosphor(const Phosphor &) = delete;
+    Phosphor & operator=(const Phosphor &) = delete;
+
+    QRect track(const QRect & hits);
+    void forBands(const QRect & rect, const std::function<void(int, int)> & rows);
+
+    int m_width = 0;
+    int m_height = 0;
+    int m_stride = 0;
+    float * m_buf = NULL;
+    float * m_planes[3];
+
+    qint64 m_time = 0;          // ns of scope time decayed through
+    qint64 m_fadeNs = 0;        // from PHOSPHOR_MAX down to invisible
+    struct Bucket {
+        qint64 start = 0;
+        QRect rect;
+    };
+    QVector<Bucket> m_buckets;
+    int m_bucket = 0;
+    QRect m_live;               // may be above black
+    bool m_cleared = true;
+    QVector<int> m_bands;
+};
+
+#endif /* phosphor_hpp */
@@ -0,0 +1,186 @@
+//
+//  point_raster.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <cstring>
+#include <QtConcurrent>
+#include "point_raster.hpp"
+
+PointRaster::~PointRaster()
+{
+    qFreeAligned(m_surface);
+}
+
+void PointRaster::resize(int width, int height)
+{
+    if(width == m_width && height == m_height)
+        return;
+    m_width = width;
+    m_height = height;
+    m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    qFreeAligned(m_surface);
+    m_surface = (quint8 *) qMallocAligned(m_tilesX*m_tilesY*TILE_SIZE*TILE_SIZE*4, 64);
+    m_binStart.resize(m_tilesX*m_tilesY + 1);
+}
+
+// Counting sort of point indices into every tile their cross-hair touches.
+void PointRaster::bin(int arm)
+{
+    const int tiles = m_tilesX*m_tilesY;
+    m_binStart.fill(0);
+    quint32 * start = m_binStart.data();
+
+    for(int pass = 0; pass < 2; pass++) {
+        for(int i = 0; i < m_points.size(); i++) {
+            const Point & p = m_points[i];
+            const int tx = p.x / TILE_SIZE;
+            const int ty = p.y / TILE_SIZE;
+            const int rx0 = qMax(0, p.x - arm) / TILE_SIZE;
+            const int rx1 = qMin(m_width - 1, p.x + arm) / TILE_SIZE;
+            const int cy0 = qMax(0, p.y - arm) / TILE_SIZE;
+            const int cy1 = qMin(m_height - 1, p.y + arm) / TILE_SIZE;
+            for(int t = ty*m_tilesX + rx0; t <= ty*m_tilesX + rx1; t++) {
+                if(pass == 0)
+                    start[t]++;
+                else
+                    m_binned[start[t]++] = i;
+            }
+            for(int y = cy0; y <= cy1; y++) {
+                if(y == ty)
+                    continue;
+                const int t = y*m_tilesX + tx;
+                if(pass == 0)
+                    start[t]++;
+                else
+                    m_binned[start[t]++] = i;
+            }
+        }
+        if(pass == 0) {
+            // exclusive prefix sum; start[t] becomes the write cursor
+            m_active.resize(0);
+            quint32 sum = 0;
+            for(int t = 0; t < tiles; t++) {
+                quint32 c = start[t];
+                if(c > 0)
+                    m_active.append(t);
+                start[t] = sum;
+                sum += c;
+            }
+            start[tiles] = sum;
+            if((quint32) m_binned.size() < sum)
+                m_binned.resize(sum);
+        }
+    }
+    // the fill pass left start[t] at the end of bin t; shift back
+    for(int t = tiles; t > 0; t--)
+        start[t] = start[t-1];
+    start[0] = 0;
+}
+
+QRect PointRaster::bounds(int arm) const
+{
+    if(m_points.isEmpty())
+        return QRect();
+    int x0 = m_width, y0 = m_height, x1 = -1, y1 = -1;
+    for(const Point & p : m_points) {
+        x0 = qMin(x0, (int) p.x);
+        x1 = qMax(x1, (int) p.x);
+        y0 = qMin(y0, (int) p.y);
+        y1 = qMax(y1, (int) p.y);
+    }
+    return QRect(QPoint(x0 - arm, y0 - arm), QPoint(x1 + arm, y1 + arm))
+           & QRect(0, 0, m_width, m_height);
+}
+
+void PointRaster::render(QImage & image, int arm, int falloff)
+{
+    // Take the scanline base once here; bits()/scanLine() detach the
+    // image and must not be called from the tile tasks.
+    Target target = {image.bits(), image.bytesPerLine(), {NULL, NULL, NULL}, 0, 0};
+    renderAll(target, arm, falloff);
+}
+
+void PointRaster::accumulate(float * const planes[3], int stride, float ceiling, int arm, int falloff)
+{
+    Target target = {NULL, 0, {planes[0], planes[1], planes[2]}, stride, ceiling};
+    renderAll(target, arm, falloff);
+}
+
+void PointRaster::renderAll(const Target & target, int arm, int falloff)
+{
+    if(m_points.isEmpty() || m_surface == NULL)
+        return;
+    bin(arm);
+    QtConcurrent::blockingMap(m_active, [this, &target, arm, falloff](int t) {
+        renderTile(t, target, arm, falloff);
+    });
+}
+
+void PointRaster::renderTile(int t, const Target & target, int arm, int falloff)
+{
+    const int x0 = (t % m_tilesX) * TILE_SIZE;
+    const int y0 = (t / m_tilesX) * TILE_SIZE;
+    const int x1 = qMin(x0 + TILE_SIZE, m_width);
+    const int y1 = qMin(y0 + TILE_SIZE, m_height);
+    quint8 * surface = tile(t);
+    memset(surface, 0, TILE_SIZE*TILE_SIZE*4);
+#define PX(x, y) (surface + (((y) - y0)*TILE_SIZE + ((x) - x0))*4)
+
+    const quint32 * bin = m_binStart.constData();
+    const quint32 * binned = m_binned.constData();
+    const Point * points = m_points.constData();
+    for(quint32 b = bin[t]; b < bin[t+1]; b++) {
+        const Point & p = points[binned[b]];
+        if(p.y >= y0 && p.y < y1) {
+            for(int x = qMax(x0, p.x - arm); x < qMin(x1, p.x + arm + 1); x++) {
+                int v = p.red - (qAbs(x - p.x)*falloff*255 >> 8);
+                if(x != p.x && v > 0)
+                    PX(x, p.y)[2] = qMax((int) PX(x, p.y)[2], v);
+            }
+        }
+        if(p.x >= x0 && p.x < x1) {
+            for(int y = qMax(y0, p.y - arm); y < qMin(y1, p.y + arm + 1); y++) {
+                int v = p.blue - (qAbs(y - p.y)*falloff*255 >> 8);
+                if(y != p.y && v > 0)
+                    PX(p.x, y)[0] = qMax((int) PX(p.x, y)[0], v);
+            }
+            if(p.y >= y0 && p.y < y1) {
+                quint8 * px = PX(p.x, p.y);
+                px[0] = qMax(px[0], p.red);
+                px[1] = qMin(255, px[1] + 1);
+                px[2] = qMax(px[2], p.blue);
+            }
+        }
+    }
+
+    // Only pixels a point landed on count hits; write those straight into
+    // the RGB32 scanlines, full green, or add them to the planes.
+    for(int y = y0; y < y1; y++) {
+        if(target.bits != NULL) {
+            QRgb * line = reinterpret_cast<QRgb *>(target.bits + y*target.bpl);
+            for(int x = x0; x < x1; x++) {
+                const quint8 * px = PX(x, y);
+                if(px[0] && px[1] && px[2])
+                    line[x] = qRgb(px[0], 255, px[2]);
+            }
+        } else {
+            float * r = target.planes[0] + y*target.stride;
+            float * g = target.planes[1] + y*target.stride;
+            float * b = target.planes[2] + y*target.stride;
+            for(int x = x0; x < x1; x++) {
+                const quint8 * px = PX(x, y);
+                if(px[1]) {
+                    const float hits = px[1];
+                    r[x] = qMin(target.ceiling, r[x] + hits * px[0] * (1.0f/255));
+                    g[x] = qMin(target.ceiling, g[x] + hits);
+                    b[x] = qMin(target.ceiling, b[x] + hits * px[2] * (1.0f/255));
+                }
+            }
+        }
+    }
+#undef PX
+}
@@ -0,0 +1,113 @@
+//
+//  point_raster.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef point_raster_hpp
+#define point_raster_hpp
+
+#include <QImage>
+#include <QRect>
+#include <QVector>
+
+#define TILE_SIZE 64
+// the traces fade by 5% a frame, so ~108 frames to drop below 1/255
+#define TRACE_FADE_FRAMES 108
+
+// Tile-binned rasterizer for the analytic trace. Each point lights its own
+// pixel and drags a fading cross-hair of length `arm` along its row (blue)
+// and column (red). Points are binned by the TILE_SIZE x TILE_SIZE tiles
+// their cross-hair touches, and tiles are splatted in parallel into a
+// persistent 8-bit accumulation surface that stays resident in L1 while a
+// tile is being worked on. Channels combine by max, so the result does not
+// depend on the order tiles are processed in.
+class PointRaster {
+public:
+    PointRaster() {}
+    ~PointRaster();
+
+    void resize(int width, int height);
+
+    void begin() {m_points.resize(0);}
+    void add(int x, int y, quint8 red, quint8 blue) {
+        m_points.append(Point{(qint16) x, (qint16) y, red, blue});
+    }
+    int count() const {return m_points.size();}
+    // pixels render() will touch for the points added so far
+    QRect bounds(int arm) const;
+
+    // Splats every added point and writes the lit pixels into `image`,
+    // which must be Format_RGB32.
+    // `falloff` is the intensity lost per pixel along an arm, in 1/256ths.
+    void render(QImage & image, int arm, int falloff);
+    // As render(), but adds the lit pixels into three float planes (R, G,
+    // B, `stride` floats a row), weighted by how many points hit each,
+    // and saturating at `ceiling`.
+    void accumulate(float * const planes[3], int stride, float ceiling, int arm, int falloff);
+
+private:
+    struct Point {
+        qint16 x, y;
+        quint8 red, blue;
+    };
+
+    PointRaster(const PointRaster &) = delete;
+    PointRaster & operator=(const PointRaster &) = delete;
+
+    // where renderTile() puts the lit pixels: an RGB32 image or planes
+    struct Target {
+        uchar * bits;
+        int bpl;
+        float * planes[3];
+        int stride;
+        float ceiling;
+    };
+
+    void bin(int arm);
+    void renderAll(const Target & target, int arm, int falloff);
+    void renderTile(int tile, const Target & target, int arm, int falloff);
+    quint8 * tile(int t) {return m_surface + t*TILE_SIZE*TILE_SIZE*4;}
+
+    int m_width = 0;
+    int m_height = 0;
+    int m_tilesX = 0;
+    int m_tilesY = 0;
+    quint8 * m_surface = NULL;      // R, hits, B, x; tile-major
+
+    QVector<Point> m_points;
+    QVector<quint32> m_binStart;    // per tile, into m_binned
+    QVector<quint32> m_binned;      // point indices grouped by tile
+    QVector<int> m_active;          // tiles with at least one point
+};
+
+// Where a trace that fades out over `frames` frames may still be changing
+// pixels: the union of the last `frames` frames' bounds. Everything
+// outside it is already black, so the fade and the repaint can skip it.
+class FadeRegion {
+public:
+    explicit FadeRegion(int frames) : m_bounds(frames) {}
+
+    // Adds this frame's bounds and returns the live region. A new image
+    // size makes the whole image live until it has faded out.
+    QRect push(const QRect & bounds, const QSize & size) {
+        if(size != m_size) {
+            m_size = size;
+            m_bounds.fill(QRect(QPoint(0, 0), size));
+        }
+        m_bounds[m_at] = bounds;
+        m_at = (m_at + 1) % m_bounds.size();
+        QRect live;
+        for(const QRect & r : m_bounds)
+            live |= r;
+        return live;
+    }
+
+private:
+    QVector<QRect> m_bounds;
+    QSize m_size;
+    int m_at = 0;
+};
+
+#endif /* point_raster_hpp */
@@ -0,0 +1,194 @@
+//
+//  raster_image.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <cstring>
+#include "raster_image.hpp"
+
+void RasterWorker::run()
+{
+    m_image->run();
+}
+
+void RasterImage::start()
+{
+    m_restart.storeRelease(1);
+    m_running.storeRelease(1);
+    if(!m_worker.isRunning())
+        m_worker.start();
+    m_wake.release();
+}
+
+void RasterImage::stop()
+{
+    m_running.storeRelease(0);
+}
+
+void RasterImage::quit()
+{
+    if(m_worker.isRunning()) {
+        m_quit.storeRelease(1);
+        m_wake.release();
+        m_worker.wait();
+    }
+}
+
+quint32 RasterImage::frameSizeFor(quint32 rate)
+{
+    const quint64 scaled = (quint64) BASE_FRAME_SIZE * rate / DEFAULT_SAMPLE_RATE;
+    quint32 len = MIN_FRAME_SIZE;
+    while(len < scaled)
+        len *= 2;
+    return len;
+}
+
+void RasterImage::setFormat(const SampleFormat & format)
+{
+    SampleFormat f = format;
+    f.channels = qMax(1, format.channels);
+    f.rate = qMax(1U, format.rate);
+    const quint32 len = frameSizeFor(f.rate);
+    const bool reshape = f.channels != m_ring.channels() || f.rate != m_format.rate || len != m_len;
+    m_format = f;
+    if(!reshape)
+        return;
+    const bool wasRunning = m_worker.isRunning();
+    quit();
+    m_quit.storeRelease(0);
+    if(len != m_len) {
+        // keep the same fraction of each frame overlapping
+        const quint32 overlap = (quint64) (m_len - hop()) * len / m_len;
+        m_len = len;
+        m_hop.storeRelaxed(len - qMin(overlap, len - 1));
+    }
+    m_ring.configure(m_len * RING_FRAMES, m_format.channels);
+    m_data.fill(NULL, m_ring.channels());
+    m_reformat = true;
+    if(wasRunning) {
+        m_worker.start();
+        m_wake.release();
+    }
+}
+
+// The samples are already in the scope's precision; the ring only has
+// to deinterleave.
+void RasterImage::feed(const scope_real * samples, quint32 len)
+{
+    if(ScopeStats::enabled())
+        m_stats.captured(len);
+    m_ring.write(samples, len);
+}
+
+bool RasterImage::peekFrame()
+{
+    for(int c = 0; c < m_data.size(); c++) {
+        if((m_data[c] = m_ring.peek(m_len, c)) == NULL)
+            return false;
+    }
+    return true;
+}
+
+void RasterImage::resize(const QSize & size)
+{
+    preResize(size);
+    m_sizeBox.post(size);
+    m_wake.release();
+}
+
+void RasterImage::render(const scope_real * frame, qint64 stride)
+{
+    m_offline = true;
+    frameBoundary();
+    for(int c = 0; c < m_data.size(); c++)
+        m_data[c] = frame + c * stride;
+    refreshTimed();
+}
+
+void RasterImage::run()
+{
+    while(!m_quit.loadAcquire()) {
+        m_wake.acquire();
+        m_wake.tryAcquire(m_wake.available());
+        frameBoundary();
+        if(!m_running.loadAcquire())
+            continue;
+
+        // Render every complete len() window waiting in the ring,
+        // stepping by hop() so consecutive frames overlap.
+        quint32 frames = 0;
+        while(!m_quit.loadAcquire() && peekFrame()) {
+            qint64 captured = 0;
+            if(ScopeStats::enabled()) {
+                // the newest sample in the window arrived about as long
+                // ago as the samples queued behind it take to play
+                qint64 start = ScopeStats::now();
+                qint64 backlog = m_ring.available() - m_len;
+                captured = start - backlog * 1000000000LL / sampleRate();
+                refreshTimed();
+                m_stats.refreshed(ScopeStats::now() - start);
+            } else {
+                refreshTimed();
+            }
+            publish(captured);
+            m_ring.advance(hop());
+            frameBoundary();
+            frames++;
+        }
+
+        // Input comes in blocks, so a wake short of a frame is normal;
+        // it is an underrun only once the next frame is overdue.
+        const qint64 now = ScopeStats::now();
+        const qint64 nsPerSample = 1000000000LL / sampleRate();
+        if(frames > 0) {
+            m_due = now + hop() * nsPerSample;
+        } else if(m_due == 0) {
+            m_due = now + len() * nsPerSample;
+        } else if(now >= m_due) {
+            m_ring.underrun();
+            m_due = now + hop() * nsPerSample;
+        }
+    }
+}
+
+// Parameter and geometry changes posted from the GUI thread take effect
+// here, between frames.
+void RasterImage::frameBoundary()
+{
+    QSize size;
+    if(m_sizeBox.fetch(size) && size != QImage::size()) {
+        QImage::operator=(scaled(size.width(), size.height()));
+        m_unseen = rect();
+        postResize();
+    }
+    if(m_reformat) {
+        m_reformat = false;
+        m_due = 0;
+        postFormat();
+    }
+    if(m_restart.fetchAndStoreAcquire(0)) {
+        m_ring.reset();
+        m_due = 0;
+        postStart();
+    }
+    applyParams();
+}
+
+void RasterImage::publish(qint64 captured)
+{
+    QImage & back = m_frames.back().image;
+    if(back.size() != QImage::size() || back.format() != format())
+        back = QImage(QImage::size(), format());
+    memcpy(back.bits(), constBits(), sizeInBytes());
+    m_frames.back().captured = captured;
+    // The GUI may skip frames, so each one carries every change since the
+    // last frame known to have been picked up.
+    m_unseen |= m_dirty;
+    m_frames.back().dirty = m_unseen;
+    if(!m_frames.publish())
+        m_unseen = m_dirty;
+    if(m_frameSink)
+        m_frameSink();
+}
@@ -9,68 +9,245 @@
 #define raster_image_hpp
 
 #include <QImage>
-#include <QMutex>
+#include <QThread>
+#include <QSemaphore>
 #include <QWidget>
 #include <QWheelEvent>
 #include <QResizeEvent>
+#include <QVector>
+#include <functional>
+
+#include "sample_ring.hpp"
+#include "sample_ingest.hpp"
+#include "triple_buffer.hpp"
+#include "stage_clock.hpp"
+#include "scope_stats.hpp"
 
 #define FRAME_SPAN 64
-#define FRAME_SIZE 4096
+// The frame is BASE_FRAME_SIZE samples at DEFAULT_SAMPLE_RATE and scales
+// with the capture rate (see frameSizeFor()), so a frame spans about the
+// same time and FFT bins the same bandwidth at any rate.
+#define BASE_FRAME_SIZE 4096
+#define MIN_FRAME_SIZE 1024
+#define RING_FRAMES 16
 #define PIXEL_SCALE 2
 #define INIT_SIZE 800
-#define SAMPLE_RATE 48000
+// frames the capture side converts per ingest() call
+#define INGEST_FRAMES 1024
+
+class RasterImage;
+
+// A published frame, stamped with when its newest sample was captured
+// (ScopeStats::now() time, 0 when stats are off). `dirty` bounds where it
+// differs from the last frame the GUI picked up.
+struct RasterFrame {
+    RasterFrame() {}
+    explicit RasterFrame(const QImage & i) : image(i), dirty(i.rect()) {}
+    QImage image;
+    qint64 captured = 0;
+    QRect dirty;
+};
+
+class RasterWorker : public QThread {
+public:
+    explicit RasterWorker(RasterImage * image) : m_image(image) {}
+protected:
+    void run() override;
+private:
+    RasterImage * m_image;
+};
 
+// A scope renders into itself (the QImage base) on its own worker thread
+// and publishes each finished frame through a triple buffer, so the GUI
+// thread only ever sees complete frames and never waits on the worker.
+//
+// Thread ownership:
+//   GUI thread    start(), stop(), feed()*, wake()*, resize(), wheelEvent(),
+//                 preResize(), nextFrame(), frontBuffer(), presented()
+//   worker thread refreshImpl(), postResize(), applyParams(), and the
+//                 QImage surface itself
+// (*feed() and wake() are called by whichever thread the capture side
+// runs on.)
+//
+// Headless renders skip the worker: render() runs a frame synchronously
+// on the calling thread, one thread per scope.
+//
+// The capture format, rate included, comes from setFormat(). A change of
+// rate or frame size reaches the scope through postFormat() on the
+// worker, before the first frame in the new format.
+//
+// start() leaves the ring to the worker too: at its next frame boundary
+// the worker drops whatever input queued up before the start and calls
+// postStart(), so nothing from before a pause or a new source is drawn.
+//
+// Scopes render into Format_RGB32, which the raster paint engine blits
+// without conversion, and narrow each frame's dirty rect with setDirty()
+// when they know they only touched part of the image.
+//
+// Subclasses must call quit() first thing in their destructor so the
+// worker is gone before their buffers are released.
 class RasterImage : public QImage {
-    
+
 public:
     explicit RasterImage(QWidget *) : QImage(INIT_SIZE/PIXEL_SCALE,  //parent->rect().width(),
                INIT_SIZE/PIXEL_SCALE, //parent->rect().height(),
-               QImage::Format_RGB888){
-        m_mutex = new QMutex();
-        m_len = FRAME_SIZE;
-        m_data = new qint16[m_len];
+               QImage::Format_RGB32), m_ring(BASE_FRAME_SIZE * RING_FRAMES),
+               m_frames(RasterFrame(QImage(INIT_SIZE/PIXEL_SCALE, INIT_SIZE/PIXEL_SCALE, QImage::Format_RGB32))),
+               m_worker(this){
+        m_len = BASE_FRAME_SIZE;
+        m_hop.storeRelaxed(BASE_FRAME_SIZE / 2);
+        m_data.fill(NULL, 1);
+        fill(Qt::black);
+        for(int i = 0; i < 3; i++) {
+            m_frames.back().image.fill(Qt::black);
+            m_frames.publish();
+        }
     }
-    
+
     ~RasterImage() {
-        delete m_mutex;
-        delete [] m_data;
+        quit();
     }
-    qint16 * & data()  {return m_data;}
-    quint32 & len()    {return m_len;}
-    void start() {
-        m_mutex->lock();
-        m_running = 1;
-        m_mutex->unlock();
-        
+    const scope_real * data(int channel = 0) const {return m_data[channel];}
+    int channels() const  {return m_data.size();}
+    // frame size, the length of each data() window
+    quint32 len() const   {return m_len;}
+    quint32 hop() const   {return m_hop.loadRelaxed();}
+    quint32 sampleRate() const {return m_format.rate;}
+    SampleRing & ring()   {return m_ring;}
+    void setOverlap(quint32 overlap) {
+        m_hop.storeRelaxed(m_len - qMin(overlap, m_len-1));
     }
-    void stop()  {
-        m_mutex->lock();
-        m_running = 0;
-        m_mutex->unlock();
-        
+    // BASE_FRAME_SIZE scaled to `rate`, rounded up to a power of two
+    static quint32 frameSizeFor(quint32 rate);
+
+    void start();
+    void stop();
+    void quit();
+    bool running() {return m_running.loadAcquire();}
+
+    // GUI side, while no producer is feeding: the capture format,
+    // including its channel count and rate. Restarts the worker around a
+    // change of either, resizing the frame and ring to the rate.
+    void setFormat(const SampleFormat & format);
+    const SampleFormat & sampleFormat() const {return m_format;}
+
+    // producer side: append `len` interleaved frames, already ingest()ed
+    // from sampleFormat(), then wake() the worker once the block is in.
+    // The capture side converts each block once for all the scopes it
+    // feeds.
+    void feed(const scope_real * samples, quint32 len);
+    void wake() {m_wake.release();}
+
+    // GUI side: picks up the latest completed frame, if there is a new
+    // one, and returns the region that changed since the last one
+    bool nextFrame(QRect & dirty) {
+        if(!m_frames.update())
+            return false;
+        m_frontPresented = false;
+        dirty = m_frames.front().dirty;
+        return true;
     }
-    void refresh(qint16 * _data, quint32 len) {
-        if(m_running) {
-            if(m_mutex->tryLock()) {
-                memcpy(m_data, _data, len*sizeof(qint16));
-                m_len = len;
-                refreshImpl();
-                m_mutex->unlock();
-            }
-        }
+    // GUI side: the frame last picked up, valid until the next nextFrame()
+    const RasterFrame & frontBuffer() {return m_frames.front();}
+    // GUI side: the front frame has been painted; the first paint of each
+    // frame counts its capture-to-photon latency
+    void presented() {
+        if(m_frontPresented)
+            return;
+        m_frontPresented = true;
+        if(m_frames.front().captured != 0 && ScopeStats::enabled())
+            m_stats.shown(ScopeStats::now() - m_frames.front().captured);
     }
-    
-    bool running() {return m_running;}
-    
-    virtual void wheelEvent(QWheelEvent *ev) {}
+    // GUI side: hot path counters, including the ring's
+    ScopeStats::Totals stats() {
+        ScopeStats::Totals t = m_stats.sample();
+        t.samplesDropped = m_ring.overruns();
+        t.underruns = m_ring.underruns();
+        return t;
+    }
+    void painted(qint64 ns) {m_stats.painted(ns);}
+    void resize(const QSize & size);
+
+    // Headless: render one len() window in place, never alongside
+    // start(). The result is the QImage itself. Each channel's window
+    // starts `stride` samples after the one before; 0 gives every channel
+    // the same one.
+    void render(const scope_real * frame, qint64 stride = 0);
+    // frames of input it takes a fresh scope to catch up with one that
+    // has been running, i.e. how far back rendered history reaches
+    virtual quint32 historyFrames() const {return 0;}
+
+    // Per-stage timing of refreshImpl(), off unless a clock is set. The
+    // clock belongs to the thread rendering the scope.
+    void setStageClock(StageClock * clock) {m_clock = clock;}
+
+    // Called on the worker after each published frame, when set.
+    void setFrameSink(const std::function<void()> & sink) {m_frameSink = sink;}
+
+    // Title updates (parameter readouts) go here, when set.
+    void setTitleSink(const std::function<void(const QString &)> & sink) {
+        m_titleSink = sink;
+    }
+
+    virtual void wheelEvent(QWheelEvent *) {}
+    virtual void preResize(const QSize &) {}
     virtual void postResize() {}
+    // worker side: len() or sampleRate() changed
+    virtual void postFormat() {}
+    // worker side: start() was called, and the ring emptied; the input
+    // picks up afresh from here
+    virtual void postStart() {}
 protected:
     virtual void refreshImpl() = 0;
+    virtual void applyParams() {}
+    void setTitle(const QString & title) {
+        if(m_titleSink)
+            m_titleSink(title);
+    }
+    bool offline() const {return m_offline;}
+    // worker side: what this frame's refreshImpl() changed, the whole
+    // image unless narrowed
+    void setDirty(const QRect & rect) {m_dirty = rect;}
+    void stage(StageClock::Stage s) {
+        if(m_clock)
+            m_clock->mark(s);
+    }
 private:
-    QMutex * m_mutex;
-    qint16 * m_data;
+    friend class RasterWorker;
+    void run();
+    void frameBoundary();
+    void publish(qint64 captured);
+    void refreshTimed() {
+        if(m_clock)
+            m_clock->begin();
+        m_dirty = rect();
+        refreshImpl();
+    }
+
+    SampleRing m_ring;
+    bool peekFrame();
+
+    QVector<const scope_real *> m_data; // per channel
+    SampleFormat m_format;
     quint32 m_len;
-    bool m_running = 0;
+    QAtomicInteger<quint32> m_hop;
+    QAtomicInt m_running;
+    QAtomicInt m_restart;   // postStart() due at the next frame boundary
+    QAtomicInt m_quit;
+    QSemaphore m_wake;
+    Mailbox<QSize> m_sizeBox;
+    TripleBuffer<RasterFrame> m_frames;
+    QRect m_dirty;      // this frame's
+    QRect m_unseen;     // since the GUI last picked a frame up
+    ScopeStats m_stats;
+    RasterWorker m_worker;
+    std::function<void(const QString &)> m_titleSink;
+    std::function<void()> m_frameSink;
+    bool m_frontPresented = true;
+    bool m_reformat = false;    // postFormat() due at the next frame boundary
+    qint64 m_due = 0;           // ScopeStats::now() the next frame is due by; 0 after a start
+    bool m_offline = false;
+    StageClock * m_clock = nullptr;
 };
 
 #endif /* raster_image_hpp */
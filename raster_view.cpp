@@ -7,26 +7,85 @@
 
 #include <QPainter>
 #include <QRect>
+#include <QFontDatabase>
+#include <cstring>
 
 #include "raster_view.hpp"
 
-void RasterView::paintEvent(QPaintEvent *)
+// Nearest-neighbour PIXEL_SCALE blow-up of `rect` of `src` into `dst`:
+// each source row is widened once and then copied down.
+static void upscale(const QImage & src, const QRect & rect, QImage & dst)
+{
+    const int left = rect.left()*PIXEL_SCALE;
+    const size_t rowBytes = rect.width()*PIXEL_SCALE*sizeof(QRgb);
+    for(int y = rect.top(); y <= rect.bottom(); y++) {
+        const QRgb * in = reinterpret_cast<const QRgb *>(src.constScanLine(y));
+        QRgb * out = reinterpret_cast<QRgb *>(dst.scanLine(y*PIXEL_SCALE)) + left;
+        QRgb * o = out;
+        for(int x = rect.left(); x <= rect.right(); x++)
+            for(int k = 0; k < PIXEL_SCALE; k++)
+                *o++ = in[x];
+        for(int k = 1; k < PIXEL_SCALE; k++)
+            memcpy(reinterpret_cast<QRgb *>(dst.scanLine(y*PIXEL_SCALE + k)) + left, out, rowBytes);
+    }
+}
+
+void RasterView::refresh()
+{
+    RasterImage * rim = (RasterImage *) m_image;
+    QRect dirty;
+    if(!rim->nextFrame(dirty))
+        return;
+    if(!dirty.isEmpty())
+        update(QRect(dirty.topLeft()*PIXEL_SCALE, dirty.size()*PIXEL_SCALE));
+    if(m_hudShown)
+        update(m_hudRect);
+}
+
+void RasterView::paintEvent(QPaintEvent * event)
 {
     QPainter painter(this);
+    RasterImage * rim = (RasterImage *) m_image;
+    const bool timed = ScopeStats::enabled();
+    const qint64 start = timed ? ScopeStats::now() : 0;
+    const QImage & frame = rim->frontBuffer().image;
+    
+    if(m_scaled.size() != frame.size()*PIXEL_SCALE)
+        m_scaled = QImage(frame.size()*PIXEL_SCALE, QImage::Format_RGB32);
+    const QRect exposed = event->rect();
+    const QRect src = QRect(QPoint(exposed.left()/PIXEL_SCALE, exposed.top()/PIXEL_SCALE),
+                            QPoint(exposed.right()/PIXEL_SCALE, exposed.bottom()/PIXEL_SCALE))
+                      & frame.rect();
+    if(!src.isEmpty()) {
+        upscale(frame, src, m_scaled);
+        const QRect dst(src.topLeft()*PIXEL_SCALE, src.size()*PIXEL_SCALE);
+        painter.drawImage(dst.topLeft(), m_scaled, dst);
+    }
+    if(timed)
+        rim->painted(ScopeStats::now() - start);
+    rim->presented();
     
-    painter.setPen(Qt::NoPen);
-    painter.drawImage(painter.viewport(), *m_image, m_image->rect());
+    if(m_hudShown && !m_hudLines.isEmpty()) {
+        QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+        painter.setFont(font);
+        const int lineHeight = painter.fontMetrics().height();
+        QRect box(8, 8, 0, lineHeight * m_hudLines.size() + 8);
+        for(const QString & line : m_hudLines)
+            box.setWidth(qMax(box.width(), painter.fontMetrics().horizontalAdvance(line) + 8));
+        m_hudRect = box;
+        painter.fillRect(box, QColor(0, 0, 0, 160));
+        painter.setPen(Qt::green);
+        for(int i = 0; i < m_hudLines.size(); i++)
+            painter.drawText(box.left() + 4, box.top() + 4 + lineHeight*i + painter.fontMetrics().ascent(),
+                             m_hudLines[i]);
+    }
 }
 
 void RasterView::postResize() {
     size_t maxX = rect().width()/PIXEL_SCALE;
     size_t maxY = rect().height()/PIXEL_SCALE;
     RasterImage * rim = (RasterImage *) m_image;
-    if(rim->running()) {
-        rim->stop();
-        (*m_image) = m_image->scaled(maxX, maxY);
-        ((RasterImage *) m_image)->postResize();
-        rim->start();
-    }
+    if(rim->running())
+        rim->resize(QSize(maxX, maxY));
 }
 
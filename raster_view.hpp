@@ -17,6 +17,9 @@
 
 #include "raster_image.hpp"
 
+// Shows the active scope's frames at PIXEL_SCALE. Only what changed is
+// invalidated, and painting blows up just the exposed part of the frame
+// into a widget-sized RGB32 copy that is blitted unscaled.
 class RasterView : public QWidget
 {
     Q_OBJECT
@@ -27,27 +30,32 @@ public:
         setPalette(QPalette(QPalette::Window, Qt::black));
         setAutoFillBackground(true);
     }
-    ~RasterView() {delete m_image;}
-    void setData(qint16 * _data, qint64 len) {
-        RasterImage * rim = (RasterImage *)m_image;
-        rim->refresh(_data, len);
-    }
+    // the window owns the scopes, which several views may show in turn
+    ~RasterView() {}
     QImage * & image() {return m_image;}
+
+    // stats overlay drawn over the frame
+    void setHud(bool shown) {m_hudShown = shown; update();}
+    bool hudShown() const {return m_hudShown;}
+    void setHudLines(const QStringList & lines) {m_hudLines = lines; update();}
     
 public slots:
     virtual void postResize();
+    // picks up the scope's latest frame and repaints what changed
+    void refresh();
 protected:
     virtual void paintEvent(QPaintEvent *) override;
     virtual void wheelEvent(QWheelEvent *ev) override {
         RasterImage * rim = (RasterImage *)m_image;
-        if(rim->running()) {
-            rim->stop();
+        if(rim->running())
             rim->wheelEvent(ev);
-            rim->start();
-        }
     }
 private:
     QImage * m_image;
+    QImage m_scaled;        // the frame at PIXEL_SCALE, as last painted
+    bool m_hudShown = false;
+    QRect m_hudRect;
+    QStringList m_hudLines;
 };
 
 
@@ -0,0 +1,250 @@
+//
+//  sample_ingest.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <QtEndian>
+#include <cstring>
+#include "sample_ingest.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define INGEST_X86 1
+#endif
+
+namespace {
+
+// full scale of each integer encoding
+const double S16_SCALE = 1.0 / 32768.0;
+const double S24_SCALE = 1.0 / 8388608.0;
+const double S32_SCALE = 1.0 / 2147483648.0;
+
+template<typename T>
+T load(const uchar * p, bool bigEndian)
+{
+    return bigEndian ? qFromBigEndian<T>(p) : qFromLittleEndian<T>(p);
+}
+
+// Samples [from, len) one at a time: the vector kernels' tails, packed
+// s24, and CPUs without SSE2.
+template<typename Out>
+void convertScalar(const char * src, quint32 len, const SampleFormat & f, Out * dst, quint32 from)
+{
+    const uchar * p = reinterpret_cast<const uchar *>(src);
+    const bool be = f.bigEndian;
+    switch(f.encoding) {
+    case SampleFormat::S16:
+        for(quint32 n = from; n < len; n++)
+            dst[n] = (Out) (load<qint16>(p + 2*n, be) * S16_SCALE);
+        break;
+    case SampleFormat::S24:
+        for(quint32 n = from; n < len; n++) {
+            const uchar * s = p + 3*n;
+            // top byte holds the sign; shift it up and back down to extend
+            quint32 u = be ? (quint32) s[0] << 24 | s[1] << 16 | s[2] << 8
+                           : (quint32) s[2] << 24 | s[1] << 16 | s[0] << 8;
+            dst[n] = (Out) (((qint32) u >> 8) * S24_SCALE);
+        }
+        break;
+    case SampleFormat::S32:
+        for(quint32 n = from; n < len; n++)
+            dst[n] = (Out) (load<qint32>(p + 4*n, be) * S32_SCALE);
+        break;
+    case SampleFormat::F32:
+        for(quint32 n = from; n < len; n++) {
+            quint32 bits = load<quint32>(p + 4*n, be);
+            float v;
+            memcpy(&v, &bits, sizeof(v));
+            dst[n] = (Out) v;
+        }
+        break;
+    }
+}
+
+#ifdef INGEST_X86
+
+#ifdef __SSE2__
+// f32 widens to double on store, which is exact.
+inline void store4(float * d, __m128 v)  {_mm_storeu_ps(d, v);}
+inline void store4(double * d, __m128 v)
+{
+    _mm_storeu_pd(d, _mm_cvtps_pd(v));
+    _mm_storeu_pd(d + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+}
+
+// Integer samples scale in the output's own precision, so double output
+// keeps all 32 bits of s32, as the scalar tail does.
+inline void storeInt4(float * d, __m128i v, double scale)
+{
+    _mm_storeu_ps(d, _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps((float) scale)));
+}
+inline void storeInt4(double * d, __m128i v, double scale)
+{
+    const __m128d k = _mm_set1_pd(scale);
+    _mm_storeu_pd(d, _mm_mul_pd(_mm_cvtepi32_pd(v), k));
+    _mm_storeu_pd(d + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(v, v)), k));
+}
+
+inline __m128i swap16(__m128i v)
+{
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+inline __m128i swap32(__m128i v)
+{
+    return swap16(_mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1));
+}
+
+// 8 samples a step. Unpacking a vector with itself puts each sample in
+// the top half of a 32-bit lane, and the arithmetic shift sign-extends.
+template<bool Swap, typename Out>
+void s16Sse2(const char * src, quint32 len, Out * dst)
+{
+    quint32 n = 0;
+    for(; n + 8 <= len; n += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (src + 2*n));
+        if(Swap)
+            v = swap16(v);
+        storeInt4(dst + n, _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16), S16_SCALE);
+        storeInt4(dst + n + 4, _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16), S16_SCALE);
+    }
+    SampleFormat f;
+    f.encoding = SampleFormat::S16;
+    f.bigEndian = Swap;
+    convertScalar(src, len, f, dst, n);
+}
+
+// s32 and f32, 4 samples a step
+template<SampleFormat::Encoding E, bool Swap, typename Out>
+void x32Sse2(const char * src, quint32 len, Out * dst)
+{
+    quint32 n = 0;
+    for(; n + 4 <= len; n += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (src + 4*n));
+        if(Swap)
+            v = swap32(v);
+        if(E == SampleFormat::F32)
+            store4(dst + n, _mm_castsi128_ps(v));
+        else
+            storeInt4(dst + n, v, S32_SCALE);
+    }
+    SampleFormat f;
+    f.encoding = E;
+    f.bigEndian = Swap;
+    convertScalar(src, len, f, dst, n);
+}
+#endif /* __SSE2__ */
+
+__attribute__((target("avx2")))
+inline void store8(float * d, __m256 v) {_mm256_storeu_ps(d, v);}
+__attribute__((target("avx2")))
+inline void store8(double * d, __m256 v)
+{
+    _mm256_storeu_pd(d, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+    _mm256_storeu_pd(d + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+}
+
+__attribute__((target("avx2")))
+inline void storeInt8(float * d, __m256i v, double scale)
+{
+    _mm256_storeu_ps(d, _mm256_mul_ps(_mm256_cvtepi32_ps(v), _mm256_set1_ps((float) scale)));
+}
+__attribute__((target("avx2")))
+inline void storeInt8(double * d, __m256i v, double scale)
+{
+    const __m256d k = _mm256_set1_pd(scale);
+    _mm256_storeu_pd(d, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), k));
+    _mm256_storeu_pd(d + 4, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)), k));
+}
+
+// As above, 8 samples a step, sign-extending with vpmovsxwd and
+// byte swapping with vpshufb.
+template<bool Swap, typename Out>
+__attribute__((target("avx2")))
+void s16Avx2(const char * src, quint32 len, Out * dst)
+{
+    const __m128i swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    quint32 n = 0;
+    for(; n + 8 <= len; n += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (src + 2*n));
+        if(Swap)
+            v = _mm_shuffle_epi8(v, swap);
+        storeInt8(dst + n, _mm256_cvtepi16_epi32(v), S16_SCALE);
+    }
+    SampleFormat f;
+    f.encoding = SampleFormat::S16;
+    f.bigEndian = Swap;
+    convertScalar(src, len, f, dst, n);
+}
+
+template<SampleFormat::Encoding E, bool Swap, typename Out>
+__attribute__((target("avx2")))
+void x32Avx2(const char * src, quint32 len, Out * dst)
+{
+    const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    quint32 n = 0;
+    for(; n + 8 <= len; n += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (src + 4*n));
+        if(Swap)
+            v = _mm256_shuffle_epi8(v, swap);
+        if(E == SampleFormat::F32)
+            store8(dst + n, _mm256_castsi256_ps(v));
+        else
+            storeInt8(dst + n, v, S32_SCALE);
+    }
+    SampleFormat f;
+    f.encoding = E;
+    f.bigEndian = Swap;
+    convertScalar(src, len, f, dst, n);
+}
+
+#endif /* INGEST_X86 */
+
+typedef void (*Kernel)(const char *, quint32, scope_real *);
+
+// [encoding][bigEndian]; S24 stays NULL and takes the scalar path
+struct Kernels {
+    Kernel k[4][2];
+};
+
+Kernels selectKernels()
+{
+    Kernels ks;
+    memset(&ks, 0, sizeof(ks));
+#ifdef INGEST_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        ks.k[SampleFormat::S16][0] = s16Avx2<false, scope_real>;
+        ks.k[SampleFormat::S16][1] = s16Avx2<true, scope_real>;
+        ks.k[SampleFormat::S32][0] = x32Avx2<SampleFormat::S32, false, scope_real>;
+        ks.k[SampleFormat::S32][1] = x32Avx2<SampleFormat::S32, true, scope_real>;
+        ks.k[SampleFormat::F32][0] = x32Avx2<SampleFormat::F32, false, scope_real>;
+        ks.k[SampleFormat::F32][1] = x32Avx2<SampleFormat::F32, true, scope_real>;
+        return ks;
+    }
+#ifdef __SSE2__
+    ks.k[SampleFormat::S16][0] = s16Sse2<false, scope_real>;
+    ks.k[SampleFormat::S16][1] = s16Sse2<true, scope_real>;
+    ks.k[SampleFormat::S32][0] = x32Sse2<SampleFormat::S32, false, scope_real>;
+    ks.k[SampleFormat::S32][1] = x32Sse2<SampleFormat::S32, true, scope_real>;
+    ks.k[SampleFormat::F32][0] = x32Sse2<SampleFormat::F32, false, scope_real>;
+    ks.k[SampleFormat::F32][1] = x32Sse2<SampleFormat::F32, true, scope_real>;
+#endif
+#endif
+    return ks;
+}
+
+const Kernels kernels = selectKernels();
+
+}
+
+void ingest(const char * src, quint32 samples, const SampleFormat & format, scope_real * dst)
+{
+    Kernel k = kernels.k[format.encoding][format.bigEndian ? 1 : 0];
+    if(k != NULL)
+        k(src, samples, dst);
+    else
+        convertScalar(src, samples, format, dst, 0);
+}
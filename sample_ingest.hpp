@@ -0,0 +1,48 @@
+//
+//  sample_ingest.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef sample_ingest_hpp
+#define sample_ingest_hpp
+
+#include <QtGlobal>
+#include "scope_real.hpp"
+
+// what capture asks for when nothing else says, and what raw files are taken to be
+#define DEFAULT_SAMPLE_RATE 48000
+
+// Wire format of captured or recorded samples. Whatever the device or
+// file delivers is converted once, on ingest, to normalized scope_real
+// in [-1, 1); nothing downstream sees the raw bytes.
+struct SampleFormat {
+    enum Encoding {S16, S24, S32, F32};
+
+    Encoding encoding = S16;
+    bool bigEndian = false;
+    int channels = 1;
+    quint32 rate = DEFAULT_SAMPLE_RATE;       // frames per second
+
+    int bytesPerSample() const {
+        switch(encoding) {
+        case S16: return 2;
+        case S24: return 3;
+        default:  return 4;
+        }
+    }
+    int bytesPerFrame() const {return bytesPerSample() * channels;}
+    bool operator==(const SampleFormat & o) const {
+        return encoding == o.encoding && bigEndian == o.bigEndian && channels == o.channels
+            && rate == o.rate;
+    }
+    bool operator!=(const SampleFormat & o) const {return !(*this == o);}
+};
+
+// Converts `samples` samples (frames * channels, still interleaved) from
+// `src` in `format` to dst. s16, s32 and f32 run on SSE2/AVX2 kernels
+// picked at startup; packed s24 is scalar.
+void ingest(const char * src, quint32 samples, const SampleFormat & format, scope_real * dst);
+
+#endif /* sample_ingest_hpp */
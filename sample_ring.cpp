@@ -0,0 +1,207 @@
+//
+//  sample_ring.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <cstring>
+#include <QVarLengthArray>
+#include "sample_ring.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define RING_X86 1
+#endif
+
+namespace {
+
+quint32 nextPow2(quint32 n) {
+    quint32 p = 1;
+    while(p < n)
+        p <<= 1;
+    return p;
+}
+
+// Splits `frames` interleaved frames of `channels` samples into planar
+// dst[c][0..frames). Stereo, by far the common case, has vector kernels.
+void deinterleaveScalar(const scope_real * src, quint32 frames, int channels,
+                        scope_real * const * dst, quint32 from)
+{
+    for(quint32 n = from; n < frames; n++)
+        for(int c = 0; c < channels; c++)
+            dst[c][n] = src[n*channels + c];
+}
+
+#ifdef RING_X86
+
+#ifdef __SSE2__
+// Even lanes of each L|R|L|R pair of vectors are left, odd lanes right.
+inline void split2(const float * src, float * l, float * r)
+{
+    __m128 a = _mm_loadu_ps(src);
+    __m128 b = _mm_loadu_ps(src + 4);
+    _mm_storeu_ps(l, _mm_shuffle_ps(a, b, 0x88));
+    _mm_storeu_ps(r, _mm_shuffle_ps(a, b, 0xDD));
+}
+inline void split2(const double * src, double * l, double * r)
+{
+    __m128d a = _mm_loadu_pd(src);
+    __m128d b = _mm_loadu_pd(src + 2);
+    _mm_storeu_pd(l, _mm_unpacklo_pd(a, b));
+    _mm_storeu_pd(r, _mm_unpackhi_pd(a, b));
+}
+
+void deinterleave2Sse2(const scope_real * src, quint32 frames, scope_real * const * dst)
+{
+    const quint32 step = 16 / sizeof(scope_real);
+    quint32 n = 0;
+    for(; n + step <= frames; n += step)
+        split2(src + 2*n, dst[0] + n, dst[1] + n);
+    deinterleaveScalar(src, frames, 2, dst, n);
+}
+#endif
+
+// As above on 256-bit vectors. The shuffles work per 128-bit lane, so
+// the 64-bit quarters come out in 0,2,1,3 order and are permuted back.
+__attribute__((target("avx2")))
+inline void split2Avx2(const float * src, float * l, float * r)
+{
+    __m256 a = _mm256_loadu_ps(src);
+    __m256 b = _mm256_loadu_ps(src + 8);
+    _mm256_storeu_pd((double *) l, _mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, 0x88)), 0xD8));
+    _mm256_storeu_pd((double *) r, _mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, 0xDD)), 0xD8));
+}
+__attribute__((target("avx2")))
+inline void split2Avx2(const double * src, double * l, double * r)
+{
+    __m256d a = _mm256_loadu_pd(src);
+    __m256d b = _mm256_loadu_pd(src + 4);
+    _mm256_storeu_pd(l, _mm256_permute4x64_pd(_mm256_unpacklo_pd(a, b), 0xD8));
+    _mm256_storeu_pd(r, _mm256_permute4x64_pd(_mm256_unpackhi_pd(a, b), 0xD8));
+}
+
+__attribute__((target("avx2")))
+void deinterleave2Avx2(const scope_real * src, quint32 frames, scope_real * const * dst)
+{
+    const quint32 step = 32 / sizeof(scope_real);
+    quint32 n = 0;
+    for(; n + step <= frames; n += step)
+        split2Avx2(src + 2*n, dst[0] + n, dst[1] + n);
+    deinterleaveScalar(src, frames, 2, dst, n);
+}
+
+#endif /* RING_X86 */
+
+typedef void (*Deinterleave2)(const scope_real *, quint32, scope_real * const *);
+
+void deinterleave2Portable(const scope_real * src, quint32 frames, scope_real * const * dst)
+{
+    deinterleaveScalar(src, frames, 2, dst, 0);
+}
+
+Deinterleave2 selectDeinterleave2()
+{
+#ifdef RING_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return deinterleave2Avx2;
+#ifdef __SSE2__
+    return deinterleave2Sse2;
+#endif
+#endif
+    return deinterleave2Portable;
+}
+
+const Deinterleave2 deinterleave2 = selectDeinterleave2();
+
+void deinterleave(const scope_real * src, quint32 frames, int channels, scope_real * const * dst)
+{
+    if(channels == 1)
+        memcpy(dst[0], src, frames*sizeof(scope_real));
+    else if(channels == 2)
+        deinterleave2(src, frames, dst);
+    else
+        deinterleaveScalar(src, frames, channels, dst, 0);
+}
+
+}
+
+SampleRing::SampleRing(quint32 capacity, int channels) :
+    m_head(0), m_overruns(0), m_tail(0), m_underruns(0)
+{
+    configure(capacity, channels);
+}
+
+SampleRing::~SampleRing()
+{
+    qFreeAligned(m_buf);
+}
+
+void SampleRing::configure(quint32 capacity, int channels)
+{
+    capacity = nextPow2(capacity);
+    channels = qMax(1, channels);
+    if(m_buf != NULL && channels == m_channels && capacity == m_capacity)
+        return;
+    qFreeAligned(m_buf);
+    m_capacity = capacity;
+    m_mask = m_capacity - 1;
+    m_channels = channels;
+    const size_t bytes = (size_t) m_channels*2*m_capacity*sizeof(scope_real);
+    m_buf = (scope_real *) qMallocAligned(bytes, CACHE_LINE);
+    memset(m_buf, 0, bytes);
+    m_head.storeRelaxed(0);
+    m_tail.storeRelaxed(0);
+}
+
+// Appends as much of `src` as fits and counts the rest as overrun;
+// never blocks and never touches the consumer's window. Each channel is
+// deinterleaved once into the primary copy, then mirrored with memcpy.
+quint32 SampleRing::write(const scope_real * src, quint32 len)
+{
+    quint32 head = m_head.loadRelaxed();
+    quint32 space = m_capacity - (head - m_tail.loadAcquire());
+    if(len > space) {
+        m_overruns.fetchAndAddRelaxed(len - space);
+        len = space;
+    }
+    quint32 pos = head & m_mask;
+    quint32 first = qMin(len, m_capacity - pos);
+
+    QVarLengthArray<scope_real *, 8> dst(m_channels);
+    for(int c = 0; c < m_channels; c++)
+        dst[c] = channel(c) + pos;
+    deinterleave(src, first, m_channels, dst.constData());
+    for(int c = 0; c < m_channels; c++) {
+        memcpy(channel(c) + pos + m_capacity, channel(c) + pos, first*sizeof(scope_real));
+        dst[c] = channel(c);
+    }
+    deinterleave(src + first*m_channels, len - first, m_channels, dst.constData());
+    for(int c = 0; c < m_channels; c++)
+        memcpy(channel(c) + m_capacity, channel(c), (len - first)*sizeof(scope_real));
+
+    m_head.storeRelease(head + len);
+    return len;
+}
+
+// Contiguous view of the oldest `len` unread samples, or NULL if fewer
+// than `len` are available.
+const scope_real * SampleRing::peek(quint32 len, int channel) const
+{
+    if(len > m_capacity || available() < len)
+        return NULL;
+    return this->channel(channel) + (m_tail.loadRelaxed() & m_mask);
+}
+
+void SampleRing::advance(quint32 len)
+{
+    m_tail.storeRelease(m_tail.loadRelaxed() + qMin(len, available()));
+}
+
+// Consumer side: drops everything written so far. The producer may go
+// on writing meanwhile.
+void SampleRing::reset()
+{
+    m_tail.storeRelease(m_head.loadAcquire());
+}
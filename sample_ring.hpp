@@ -0,0 +1,73 @@
+//
+//  sample_ring.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef sample_ring_hpp
+#define sample_ring_hpp
+
+#include <QtGlobal>
+#include <QAtomicInteger>
+#include "scope_real.hpp"
+
+#define CACHE_LINE 64
+
+// Single-producer/single-consumer ring of normalized samples between the capture
+// side and one scope. Storage is mirrored (every sample is written twice,
+// `capacity` apart) so any window of up to `capacity` samples can be
+// handed out as one contiguous pointer without copying.
+//
+// Multichannel input is deinterleaved on write into one planar ring per
+// channel sharing the same indices; lengths and positions count frames.
+class SampleRing {
+public:
+    explicit SampleRing(quint32 capacity, int channels = 1);
+    ~SampleRing();
+
+    // Reallocates for a new capacity (rounded up to a power of two) or
+    // channel count and empties the ring. Neither side may be using the
+    // ring meanwhile.
+    void configure(quint32 capacity, int channels);
+    void setChannels(int channels) {configure(m_capacity, channels);}
+    int channels() const {return m_channels;}
+
+    // producer: `len` interleaved frames, already ingested
+    quint32 write(const scope_real * src, quint32 len);
+
+    // consumer
+    const scope_real * peek(quint32 len, int channel = 0) const;
+    void advance(quint32 len);
+    void reset();
+    void underrun() {m_underruns.fetchAndAddRelaxed(1);}
+
+    quint32 available() const {
+        return m_head.loadAcquire() - m_tail.loadRelaxed();
+    }
+    quint32 capacity() const {return m_capacity;}
+    quint64 overruns() const  {return m_overruns.loadRelaxed();}
+    quint64 underruns() const {return m_underruns.loadRelaxed();}
+
+private:
+    SampleRing(const SampleRing &) = delete;
+    SampleRing & operator=(const SampleRing &) = delete;
+
+    scope_real * channel(int c) const {return m_buf + (size_t) c*2*m_capacity;}
+
+    scope_real * m_buf = NULL;
+    quint32 m_capacity = 0;
+    quint32 m_mask;
+    int m_channels = 0;
+
+    // Producer and consumer indices live on separate cache lines.
+    char m_pad0[CACHE_LINE];
+    QAtomicInteger<quint32> m_head;
+    QAtomicInteger<quint64> m_overruns;
+    char m_pad1[CACHE_LINE];
+    QAtomicInteger<quint32> m_tail;
+    QAtomicInteger<quint64> m_underruns;
+    char m_pad2[CACHE_LINE];
+};
+
+#endif /* sample_ring_hpp */
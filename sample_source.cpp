@@ -0,0 +1,349 @@
+//
+//  sample_source.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHostAddress>
+#include <QTcpSocket>
+#include <QtEndian>
+#include <poll.h>
+#include <unistd.h>
+#include "sample_source.hpp"
+#include "raster_image.hpp"
+
+namespace {
+
+// What the ingest layer makes of a QAudioFormat; false if it can't
+// take it natively.
+bool sampleFormat(const QAudioFormat & format, SampleFormat & out)
+{
+    out.channels = format.channelCount();
+    out.rate = format.sampleRate();
+    out.bigEndian = format.byteOrder() == QAudioFormat::BigEndian;
+    if(format.sampleType() == QAudioFormat::Float && format.sampleSize() == 32) {
+        out.encoding = SampleFormat::F32;
+        return true;
+    }
+    if(format.sampleType() != QAudioFormat::SignedInt)
+        return false;
+    switch(format.sampleSize()) {
+    case 16: out.encoding = SampleFormat::S16; return true;
+    case 24: out.encoding = SampleFormat::S24; return true;
+    case 32: out.encoding = SampleFormat::S32; return true;
+    default: return false;
+    }
+}
+
+// s16le as the pipe and network sources take it
+SampleFormat s16le(int channels, int rate)
+{
+    SampleFormat f;
+    f.encoding = SampleFormat::S16;
+    f.channels = qMax(1, channels);
+    f.rate = rate > 0 ? rate : DEFAULT_SAMPLE_RATE;
+    return f;
+}
+
+// QAudioInput's push mode writes into this, on the audio thread.
+class SinkDevice : public QIODevice {
+public:
+    SinkDevice(const SampleSource::Sink & sink, int frameBytes)
+        : m_sink(sink), m_frameBytes(frameBytes) {}
+    qint64 readData(char *, qint64) override {return 0;}
+    qint64 writeData(const char * data, qint64 len) override {
+        Q_ASSERT(len % m_frameBytes == 0);
+        m_sink(data, len / m_frameBytes);
+        return len;
+    }
+private:
+    SampleSource::Sink m_sink;
+    int m_frameBytes;
+};
+
+} // namespace
+
+DeviceSource::DeviceSource(const QAudioDeviceInfo & device, int channels, int rate)
+    : m_device(device), m_channels(channels), m_rate(rate)
+{
+}
+
+// The scopes size their frames to the rate, so there is no need to make
+// the device resample to a fixed one.
+bool DeviceSource::open()
+{
+    QAudioFormat format;
+    format.setSampleRate(m_rate > 0 ? m_rate : m_device.preferredFormat().sampleRate());
+    if(format.sampleRate() <= 0)
+        format.setSampleRate(DEFAULT_SAMPLE_RATE);
+    format.setChannelCount(m_channels);
+    format.setSampleSize(16);
+    format.setSampleType(QAudioFormat::SignedInt);
+    format.setByteOrder(QAudioFormat::LittleEndian);
+    format.setCodec("audio/pcm");
+
+    if (!m_device.isFormatSupported(format)) {
+        qWarning() << "Default format not supported - trying to use nearest";
+        format = m_device.nearestFormat(format);
+    }
+    // Only 8-bit and unsigned formats still need converting by Qt.
+    if (!sampleFormat(format, m_format)) {
+        qWarning() << "Unsupported sample format" << format.sampleSize() << "bit"
+                   << format.sampleType() << "- falling back to s16le";
+        format.setSampleSize(16);
+        format.setSampleType(QAudioFormat::SignedInt);
+        format.setByteOrder(QAudioFormat::LittleEndian);
+        if(!m_device.isFormatSupported(format)) {
+            m_error = QString("no %1 bit format the device supports can be ingested").arg(format.sampleSize());
+            return false;
+        }
+        sampleFormat(format, m_format);
+    }
+    m_audioFormat = format;
+    return true;
+}
+
+void DeviceSource::start(const Sink & sink)
+{
+    stop();
+    m_adapter.reset(new SinkDevice(sink, m_format.bytesPerFrame()));
+    m_adapter->open(QIODevice::WriteOnly);
+    m_input.reset(new QAudioInput(m_device, m_audioFormat));
+    m_input->start(m_adapter.data());
+}
+
+void DeviceSource::stop()
+{
+    if(!m_input.isNull())
+        m_input->stop();
+    m_input.reset();
+    m_adapter.reset();
+}
+
+void DeviceSource::suspend()
+{
+    if(!m_input.isNull())
+        m_input->suspend();
+}
+
+void DeviceSource::resume()
+{
+    if(!m_input.isNull())
+        m_input->resume();
+}
+
+void SourceThread::run()
+{
+    m_source->run();
+}
+
+ThreadedSource::ThreadedSource() : m_thread(this)
+{
+    m_quit.storeRelaxed(0);
+    m_paused.storeRelaxed(0);
+}
+
+void ThreadedSource::start(const Sink & sink)
+{
+    stop();
+    m_sink = sink;
+    m_quit.storeRelease(0);
+    m_thread.start();
+}
+
+void ThreadedSource::stop()
+{
+    m_quit.storeRelease(1);
+    m_thread.wait();
+}
+
+FileSource::FileSource(const QString & path, bool fast) : m_path(path), m_fast(fast)
+{
+}
+
+bool FileSource::open()
+{
+    if(!m_file.open(m_path)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_format = m_file.format();
+    m_format.rate = m_file.sampleRate();
+    return true;
+}
+
+QString FileSource::name() const
+{
+    return QFileInfo(m_path).fileName() + (m_fast ? " (fast)" : "");
+}
+
+void FileSource::run()
+{
+    const qint64 rate = m_format.rate;
+    QByteArray block(SOURCE_BLOCK_FRAMES * m_format.bytesPerFrame(), Qt::Uninitialized);
+    QElapsedTimer clock;
+    clock.start();
+    qint64 sent = 0;
+    while(!quitting()) {
+        if(paused()) {
+            QThread::msleep(SOURCE_POLL_MS);
+            clock.restart();
+            sent = 0;
+            continue;
+        }
+        if(!m_fast) {
+            const qint64 due = clock.nsecsElapsed() * rate / 1000000000;
+            if(sent > due) {
+                QThread::usleep(qMin((sent - due) * 1000000 / rate, (qint64) SOURCE_POLL_MS * 1000));
+                continue;
+            }
+        }
+        const qint64 frames = m_file.readFrames(block.data(), SOURCE_BLOCK_FRAMES);
+        if(frames == 0) {
+            status(QString("[%1: end of replay]").arg(name()));
+            break;
+        }
+        deliver(block.constData(), frames);
+        sent += frames;
+    }
+}
+
+StdinSource::StdinSource(int channels, int rate)
+{
+    m_format = s16le(channels, rate);
+}
+
+bool StdinSource::open()
+{
+    return true;
+}
+
+// Polls rather than blocking in read(), so stop() is never stuck behind
+// an idle pipe. A frame split across reads is carried over.
+void StdinSource::run()
+{
+    const int frameBytes = m_format.bytesPerFrame();
+    QByteArray buf(SOURCE_BLOCK_FRAMES * frameBytes, Qt::Uninitialized);
+    int have = 0;
+    while(!quitting()) {
+        struct pollfd p = {STDIN_FILENO, POLLIN, 0};
+        if(poll(&p, 1, SOURCE_POLL_MS) <= 0)
+            continue;
+        const ssize_t got = ::read(STDIN_FILENO, buf.data() + have, buf.size() - have);
+        if(got <= 0) {
+            status("[stdin: end of input]");
+            break;
+        }
+        have += got;
+        const int frames = have / frameBytes;
+        if(frames > 0 && !paused())
+            deliver(buf.constData(), frames);
+        have -= frames * frameBytes;
+        memmove(buf.data(), buf.constData() + frames * frameBytes, have);
+    }
+}
+
+NetworkSource::NetworkSource(Protocol protocol, quint16 port, int channels, int rate)
+    : m_protocol(protocol), m_port(port)
+{
+    m_format = s16le(channels, rate);
+    m_lost.storeRelaxed(0);
+    m_late.storeRelaxed(0);
+}
+
+QString NetworkSource::name() const
+{
+    return QString("%1 port %2").arg(m_protocol == Udp ? "UDP" : "TCP").arg(m_port);
+}
+
+// Binds and lets go again, so a port in use shows up as an error on the
+// GUI side. run() binds for real on the source thread.
+bool NetworkSource::open()
+{
+    if(m_protocol == Udp) {
+        QUdpSocket udp;
+        if(!udp.bind(QHostAddress::Any, m_port)) {
+            m_error = udp.errorString();
+            return false;
+        }
+    } else {
+        QTcpServer server;
+        if(!server.listen(QHostAddress::Any, m_port)) {
+            m_error = server.errorString();
+            return false;
+        }
+    }
+    return true;
+}
+
+void NetworkSource::run()
+{
+    if(m_protocol == Udp)
+        runUdp();
+    else
+        runTcp();
+}
+
+void NetworkSource::runUdp()
+{
+    const int frameBytes = m_format.bytesPerFrame();
+    QByteArray datagram(NETWORK_MAX_DATAGRAM, Qt::Uninitialized);
+    QUdpSocket udp;
+    if(!udp.bind(QHostAddress::Any, m_port)) {
+        status(QString("[%1: %2]").arg(name()).arg(udp.errorString()));
+        return;
+    }
+    m_jitter.reset();
+    while(!quitting()) {
+        if(!udp.waitForReadyRead(SOURCE_POLL_MS))
+            continue;
+        while(udp.hasPendingDatagrams()) {
+            const qint64 size = udp.readDatagram(datagram.data(), datagram.size());
+            const qint64 payload = size - (qint64) sizeof(quint32);
+            if(payload <= 0 || payload % frameBytes != 0)
+                continue;
+            m_jitter.put(qFromLittleEndian<quint32>(datagram.constData()),
+                         datagram.constData() + sizeof(quint32), payload);
+        }
+        while(const char * packet = m_jitter.take())
+            if(!paused())
+                deliver(packet, m_jitter.packetBytes() / frameBytes);
+        m_lost.storeRelaxed(m_jitter.lost());
+        m_late.storeRelaxed(m_jitter.late());
+    }
+}
+
+void NetworkSource::runTcp()
+{
+    const int frameBytes = m_format.bytesPerFrame();
+    QTcpServer server;
+    if(!server.listen(QHostAddress::Any, m_port)) {
+        status(QString("[%1: %2]").arg(name()).arg(server.errorString()));
+        return;
+    }
+    QScopedPointer<QTcpSocket> peer;
+    QByteArray pending;
+    while(!quitting()) {
+        if(peer.isNull()) {
+            if(server.waitForNewConnection(SOURCE_POLL_MS))
+                peer.reset(server.nextPendingConnection());
+            pending.clear();
+            continue;
+        }
+        if(peer->state() == QAbstractSocket::UnconnectedState) {
+            peer.reset();
+            continue;
+        }
+        if(!peer->waitForReadyRead(SOURCE_POLL_MS))
+            continue;
+        pending.append(peer->readAll());
+        const int frames = pending.size() / frameBytes;
+        if(frames > 0 && !paused())
+            deliver(pending.constData(), frames);
+        pending.remove(0, frames * frameBytes);
+    }
+}
@@ -0,0 +1,216 @@
+//
+//  sample_source.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef sample_source_hpp
+#define sample_source_hpp
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QAudioDeviceInfo>
+#include <QAudioFormat>
+#include <QAudioInput>
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QString>
+#include <QTcpServer>
+#include <QThread>
+#include <QUdpSocket>
+#include <functional>
+#include "sample_ingest.hpp"
+#include "pcm_file.hpp"
+#include "jitter_buffer.hpp"
+
+// frames per block the threaded sources hand over
+#define SOURCE_BLOCK_FRAMES 1024
+// longest a source thread waits on its input before checking for stop()
+#define SOURCE_POLL_MS 100
+#define NETWORK_DEFAULT_PORT 9999
+#define NETWORK_MAX_DATAGRAM 65536
+
+// Where captured samples come from. open() settles the format; from
+// start() until stop() the source hands raw frames in that format to
+// the sink, from whichever thread it reads on, as QAudioInput's push
+// mode does. Every source feeds the same capture path the scopes and
+// the recorder hang off.
+//
+// All calls are GUI side; the sink runs on the source's thread.
+class SampleSource {
+public:
+    typedef std::function<void(const char * bytes, quint32 frames)> Sink;
+
+    virtual ~SampleSource() {}
+
+    // false, with errorString() set, if the source can't be read
+    virtual bool open() = 0;
+    virtual void start(const Sink & sink) = 0;
+    virtual void stop() = 0;
+    // While suspended a live source drops its input and a file waits.
+    virtual void suspend() = 0;
+    virtual void resume() = 0;
+    // for the title bar
+    virtual QString name() const = 0;
+    // packets a network source lost, and dropped for coming too late;
+    // read from any thread
+    virtual quint64 packetsLost() const {return 0;}
+    virtual quint64 packetsLate() const {return 0;}
+
+    const SampleFormat & format() const {return m_format;}
+    QString errorString() const {return m_error;}
+    // Called on the source's thread when its input ends or fails; set
+    // before start().
+    void setStatusSink(const std::function<void(const QString &)> & sink) {m_statusSink = sink;}
+
+protected:
+    void status(const QString & message) {
+        if(m_statusSink)
+            m_statusSink(message);
+    }
+
+    SampleFormat m_format;
+    QString m_error;
+    std::function<void(const QString &)> m_statusSink;
+};
+
+// An audio input device, at `rate` Hz (0 for the device's preferred
+// rate) with `channels` channels if it has them. Whatever format the
+// device settles on is taken natively when the ingest layer can.
+class DeviceSource : public SampleSource {
+public:
+    DeviceSource(const QAudioDeviceInfo & device, int channels, int rate);
+    ~DeviceSource() {stop();}
+
+    bool open() override;
+    void start(const Sink & sink) override;
+    void stop() override;
+    void suspend() override;
+    void resume() override;
+    QString name() const override {return m_device.deviceName();}
+
+private:
+    QAudioDeviceInfo m_device;
+    int m_channels;
+    int m_rate;
+    QAudioFormat m_audioFormat;
+    QScopedPointer<QIODevice> m_adapter;    // what QAudioInput writes into
+    QScopedPointer<QAudioInput> m_input;
+};
+
+class ThreadedSource;
+
+class SourceThread : public QThread {
+public:
+    explicit SourceThread(ThreadedSource * source) : m_source(source) {}
+protected:
+    void run() override;
+private:
+    ThreadedSource * m_source;
+};
+
+// A source that blocks on its input reads on a thread of its own, and
+// looks for stop() at least every SOURCE_POLL_MS.
+//
+// Subclasses must call stop() first thing in their destructor so the
+// thread is gone before their members are.
+class ThreadedSource : public SampleSource {
+public:
+    ThreadedSource();
+
+    void start(const Sink & sink) override;
+    void stop() override;
+    void suspend() override {m_paused.storeRelease(1);}
+    void resume() override  {m_paused.storeRelease(0);}
+
+protected:
+    friend class SourceThread;
+    // source thread: read and deliver() until quitting() or the input ends
+    virtual void run() = 0;
+    bool quitting() const {return m_quit.loadAcquire();}
+    bool paused() const   {return m_paused.loadAcquire();}
+    void deliver(const char * bytes, quint32 frames) {m_sink(bytes, frames);}
+
+private:
+    Sink m_sink;
+    QAtomicInt m_quit;
+    QAtomicInt m_paused;
+    SourceThread m_thread;
+};
+
+// Replays a WAV or raw file (see PcmFile) in real time, or when `fast` as
+// quickly as the capture path takes it, to find the scopes' throughput
+// limits. Paced replay keeps to the clock rather than to the sum of its
+// sleeps, and starts its clock over after a suspend. Replay stops at the
+// end of the file.
+class FileSource : public ThreadedSource {
+public:
+    FileSource(const QString & path, bool fast);
+    ~FileSource() {stop();}
+
+    bool open() override;
+    QString name() const override;
+
+protected:
+    void run() override;
+
+private:
+    QString m_path;
+    bool m_fast;
+    PcmFile m_file;
+};
+
+// Headerless s16le on standard input, `channels` channels at `rate` Hz
+// (0 for DEFAULT_SAMPLE_RATE), for piping in another process's output.
+class StdinSource : public ThreadedSource {
+public:
+    StdinSource(int channels, int rate);
+    ~StdinSource() {stop();}
+
+    bool open() override;
+    QString name() const override {return "stdin";}
+
+protected:
+    void run() override;
+};
+
+// s16le from the network, `channels` channels at `rate` Hz (0 for
+// DEFAULT_SAMPLE_RATE), on `port`.
+//
+// Over TCP the stream is the bare samples, from one sender at a time.
+// Over UDP each datagram is a little-endian quint32 sequence number and
+// then whole frames, the same number of them in every datagram, and a
+// JitterBuffer puts reordered datagrams back in place and fills in lost
+// ones with silence.
+//
+// The socket lives on the source thread, made and dropped there by run();
+// open() only checks that the port can be bound.
+class NetworkSource : public ThreadedSource {
+public:
+    enum Protocol {Udp, Tcp};
+
+    NetworkSource(Protocol protocol, quint16 port, int channels, int rate);
+    ~NetworkSource() {stop();}
+
+    bool open() override;
+    QString name() const override;
+    quint64 packetsLost() const override {return m_lost.loadRelaxed();}
+    quint64 packetsLate() const override {return m_late.loadRelaxed();}
+
+protected:
+    void run() override;
+
+private:
+    void runUdp();
+    void runTcp();
+
+    Protocol m_protocol;
+    quint16 m_port;
+    JitterBuffer m_jitter;
+    // the jitter buffer's counts, for the GUI
+    QAtomicInteger<quint64> m_lost;
+    QAtomicInteger<quint64> m_late;
+};
+
+#endif /* sample_source_hpp */
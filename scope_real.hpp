@@ -0,0 +1,20 @@
+//
+//  scope_real.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef scope_real_hpp
+#define scope_real_hpp
+
+// Working precision of the scopes, picked at build time
+// (CONFIG += xyscope_float in xyscope.pro). Samples are converted to it
+// once, on ingest, and the DSP runs in it from there on.
+#ifdef XYSCOPE_FLOAT
+typedef float scope_real;
+#else
+typedef double scope_real;
+#endif
+
+#endif /* scope_real_hpp */
@@ -0,0 +1,134 @@
+//
+//  scope_stats.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <QElapsedTimer>
+#include "scope_stats.hpp"
+
+QAtomicInt ScopeStats::s_enabled;
+
+qint64 ScopeStats::now()
+{
+    static QElapsedTimer clock;
+    static bool started = (clock.start(), true);
+    Q_UNUSED(started)
+    return clock.nsecsElapsed();
+}
+
+void ScopeStats::refreshed(qint64 ns)
+{
+    m_rendered.fetchAndAddRelaxed(1);
+    m_refreshNs.fetchAndAddRelaxed(ns);
+    quint64 max = m_refreshMaxNs.loadRelaxed();
+    if((quint64) ns > max)
+        m_refreshMaxNs.storeRelaxed(ns);    // only the worker raises it
+
+    int bucket = 0;
+    for(qint64 us = ns / 1000; us > 1 && bucket < STATS_BUCKETS-1; us >>= 1)
+        bucket++;
+    m_refreshHist[bucket].fetchAndAddRelaxed(1);
+}
+
+ScopeStats::Totals ScopeStats::sample()
+{
+    Totals t;
+    t.samplesIn = m_samplesIn.loadRelaxed();
+    t.rendered = m_rendered.loadRelaxed();
+    t.shown = m_shown.loadRelaxed();
+    t.refreshNs = m_refreshNs.loadRelaxed();
+    t.refreshMaxNs = m_refreshMaxNs.fetchAndStoreRelaxed(0);
+    t.paints = m_paints.loadRelaxed();
+    t.paintNs = m_paintNs.loadRelaxed();
+    t.latencyNs = m_latencyNs.loadRelaxed();
+    for(int i = 0; i < STATS_BUCKETS; i++)
+        t.refreshHist[i] = m_refreshHist[i].loadRelaxed();
+    return t;
+}
+
+// a count that went backwards started over, with a new source
+static quint64 sinceRestart(quint64 now, quint64 prev)
+{
+    return now >= prev ? now - prev : now;
+}
+
+ScopeStats::Totals ScopeStats::Totals::since(const Totals & prev) const
+{
+    Totals d = *this;
+    d.samplesIn -= prev.samplesIn;
+    d.samplesDropped -= prev.samplesDropped;
+    d.underruns -= prev.underruns;
+    d.rendered -= prev.rendered;
+    d.shown -= prev.shown;
+    d.refreshNs -= prev.refreshNs;
+    d.paints -= prev.paints;
+    d.paintNs -= prev.paintNs;
+    d.latencyNs -= prev.latencyNs;
+    for(int i = 0; i < STATS_BUCKETS; i++)
+        d.refreshHist[i] -= prev.refreshHist[i];
+    d.packetsLost = sinceRestart(packetsLost, prev.packetsLost);
+    d.packetsLate = sinceRestart(packetsLate, prev.packetsLate);
+    d.ingestNs = sinceRestart(ingestNs, prev.ingestNs);
+    d.ingested = sinceRestart(ingested, prev.ingested);
+    return d;
+}
+
+static double avgMs(quint64 ns, quint64 n)
+{
+    return n ? ns / 1e6 / n : 0.0;
+}
+
+QString ScopeStats::Totals::json(qint64 intervalNs) const
+{
+    QStringList hist;
+    for(int i = 0; i < STATS_BUCKETS; i++)
+        hist << QString::number(refreshHist[i]);
+    return QString("{\"interval_ms\":%1,\"samples_in\":%2,\"samples_dropped\":%3,"
+                   "\"underruns\":%4,\"frames_rendered\":%5,\"frames_shown\":%6,"
+                   "\"refresh_avg_ms\":%7,\"refresh_max_ms\":%8,\"refresh_hist_log2us\":[%9],"
+                   "\"paint_avg_ms\":%10,\"latency_avg_ms\":%11,"
+                   "\"packets_lost\":%12,\"packets_late\":%13,\"ingest_ns_per_sample\":%14}")
+        .arg(intervalNs / 1000000)
+        .arg(samplesIn).arg(samplesDropped).arg(underruns)
+        .arg(rendered).arg(shown)
+        .arg(avgMs(refreshNs, rendered), 0, 'f', 3)
+        .arg(refreshMaxNs / 1e6, 0, 'f', 3)
+        .arg(hist.join(","))
+        .arg(avgMs(paintNs, paints), 0, 'f', 3)
+        .arg(avgMs(latencyNs, shown), 0, 'f', 3)
+        .arg(packetsLost).arg(packetsLate)
+        .arg(ingested ? (double) ingestNs / ingested : 0.0, 0, 'f', 2);
+}
+
+QStringList ScopeStats::Totals::hud(qint64 intervalNs) const
+{
+    const double secs = intervalNs / 1e9;
+    QStringList lines;
+    lines << QString("in %1 S/s  ingest %2 ns/S  dropped %3  underruns %4")
+                 .arg(qRound64(samplesIn / secs))
+                 .arg(ingested ? (double) ingestNs / ingested : 0.0, 0, 'f', 2)
+                 .arg(samplesDropped).arg(underruns);
+    lines << QString("render %1 fps  shown %2 fps  skipped %3")
+                 .arg(rendered / secs, 0, 'f', 1).arg(shown / secs, 0, 'f', 1)
+                 .arg(rendered > shown ? rendered - shown : 0);
+    lines << QString("refresh avg %1 ms  max %2 ms")
+                 .arg(avgMs(refreshNs, rendered), 0, 'f', 2).arg(refreshMaxNs / 1e6, 0, 'f', 2);
+    lines << QString("paint %1 ms  latency %2 ms")
+                 .arg(avgMs(paintNs, paints), 0, 'f', 2).arg(avgMs(latencyNs, shown), 0, 'f', 1);
+    if(packetsLost > 0 || packetsLate > 0)
+        lines << QString("packets lost %1  late %2").arg(packetsLost).arg(packetsLate);
+
+    // histogram as a row of bars, one per bucket from 1 us up
+    static const char * bars[] = {" ", "▁", "▂", "▃", "▄", "▅", "▆", "▇", "█"};
+    quint64 peak = 1;
+    for(int i = 0; i < STATS_BUCKETS; i++)
+        peak = qMax(peak, refreshHist[i]);
+    QString row("refresh 1us ");
+    for(int i = 0; i < STATS_BUCKETS; i++)
+        row += QString::fromUtf8(bars[(refreshHist[i] * 8 + peak - 1) / peak]);
+    row += " 32ms+";
+    lines << row;
+    return lines;
+}
@@ -0,0 +1,83 @@
+//
+//  scope_stats.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef scope_stats_hpp
+#define scope_stats_hpp
+
+#include <QAtomicInteger>
+#include <QString>
+#include <QStringList>
+
+// refresh duration histogram buckets: [2^i, 2^(i+1)) microseconds, the
+// last one open-ended
+#define STATS_BUCKETS 16
+
+// Live counters for one scope's hot path: capture, render, paint. Each
+// counter is written by the one thread that owns its stage with relaxed
+// atomics, and read from the GUI thread. Recording is off unless enabled
+// (HUD shown or --stats given); while off every hook is a single load.
+class ScopeStats {
+public:
+    struct Totals {
+        quint64 samplesIn = 0;
+        quint64 samplesDropped = 0;     // ring overruns
+        quint64 underruns = 0;          // frames overdue for want of input
+        quint64 rendered = 0;
+        quint64 shown = 0;              // rendered frames that reached paint
+        quint64 refreshNs = 0;
+        quint64 refreshMaxNs = 0;
+        quint64 paints = 0;
+        quint64 paintNs = 0;
+        quint64 latencyNs = 0;          // capture to painted, summed over shown frames
+        quint64 refreshHist[STATS_BUCKETS] = {};
+        // the source's and the capture side's, not the scope's; they
+        // start over with a new source
+        quint64 packetsLost = 0;
+        quint64 packetsLate = 0;
+        quint64 ingestNs = 0;           // in ingest(), shared by the scopes shown
+        quint64 ingested = 0;           // samples ingest() converted
+
+        // counts over the interval since `prev`; maxima are already
+        // per-interval
+        Totals since(const Totals & prev) const;
+        QString json(qint64 intervalNs) const;
+        QStringList hud(qint64 intervalNs) const;
+    };
+
+    static qint64 now();
+    static bool enabled() {return s_enabled.loadRelaxed();}
+    static void setEnabled(bool on) {s_enabled.storeRelaxed(on);}
+
+    void captured(quint32 samples) {m_samplesIn.fetchAndAddRelaxed(samples);}
+    void refreshed(qint64 ns);
+    void shown(qint64 latencyNs) {
+        m_shown.fetchAndAddRelaxed(1);
+        m_latencyNs.fetchAndAddRelaxed(latencyNs);
+    }
+    void painted(qint64 ns) {
+        m_paints.fetchAndAddRelaxed(1);
+        m_paintNs.fetchAndAddRelaxed(ns);
+    }
+
+    // GUI side; resets the refresh maximum
+    Totals sample();
+
+private:
+    static QAtomicInt s_enabled;
+
+    QAtomicInteger<quint64> m_samplesIn;
+    QAtomicInteger<quint64> m_rendered;
+    QAtomicInteger<quint64> m_shown;
+    QAtomicInteger<quint64> m_refreshNs;
+    QAtomicInteger<quint64> m_refreshMaxNs;
+    QAtomicInteger<quint64> m_paints;
+    QAtomicInteger<quint64> m_paintNs;
+    QAtomicInteger<quint64> m_latencyNs;
+    QAtomicInteger<quint64> m_refreshHist[STATS_BUCKETS];
+};
+
+#endif /* scope_stats_hpp */
@@ -0,0 +1,14 @@
+# Scope rendering and DSP, shared by the app and the benchmark.
+QMAKE_MACOSX_DEPLOYMENT_TARGET = 10.15
+QT += widgets concurrent
+SOURCES += analytic_scope.cpp spectrum_scope.cpp sample_ring.cpp raster_image.cpp point_raster.cpp spectrum_colormap.cpp fftw_traits.cpp scope_stats.cpp xy_scope.cpp sample_ingest.cpp phosphor.cpp hilbert_filter.cpp stft.cpp zoom_fft.cpp fft_cache.cpp trigger.cpp
+HEADERS += raster_image.hpp spectrum_scope.hpp analytic_scope.hpp sample_ring.hpp triple_buffer.hpp point_raster.hpp spectrum_colormap.hpp fftw_traits.hpp stage_clock.hpp scope_stats.hpp xy_scope.hpp sample_ingest.hpp scope_real.hpp phosphor.hpp hilbert_filter.hpp stft.hpp zoom_fft.hpp fft_cache.hpp trigger.hpp
+
+# qmake CONFIG+=xyscope_float runs the scope DSP in single precision (fftwf_*)
+xyscope_float {
+    DEFINES += XYSCOPE_FLOAT
+    LIBS += -L/usr/local/lib -lfftw3f_omp -lm -lfftw3f
+} else {
+    LIBS += -L/usr/local/lib -lfftw3_omp -lm -lfftw3
+}
+INCLUDEPATH += /usr/local/include
@@ -0,0 +1,258 @@
+//
+//  spectrum_colormap.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <cstring>
+#include <cfloat>
+#include <QColor>
+#include <qmath.h>
+#include "spectrum_colormap.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CMAP_X86 1
+#endif
+
+namespace {
+
+struct IndexParams {
+    float log2Scale;
+    float offset;
+    float satSlope;
+};
+
+// log2 from the float's exponent plus a quadratic fit of the mantissa
+// (|error| < 5e-3, i.e. well under one LUT step).
+const float LOG2_C0 = -1.67487759f;
+const float LOG2_C1 =  2.02466578f;
+const float LOG2_C2 = -0.34484843f;
+
+// atan on [0,1], |error| < 1e-5 rad.
+const float ATAN_C0 =  0.99986600f;
+const float ATAN_C1 = -0.33029950f;
+const float ATAN_C2 =  0.18014100f;
+const float ATAN_C3 = -0.08513300f;
+const float ATAN_C4 =  0.02083510f;
+
+const float PHASE_K = CMAP_PHASE_STEPS / (2.0f * (float) M_PI);
+
+inline float log2Approx(float x)
+{
+    quint32 bits;
+    memcpy(&bits, &x, sizeof(bits));
+    float e = (float) ((qint32) (bits >> 23) - 127);
+    bits = (bits & 0x007fffff) | 0x3f800000;
+    float m;
+    memcpy(&m, &bits, sizeof(m));
+    return e + ((LOG2_C2*m + LOG2_C1)*m + LOG2_C0);
+}
+
+inline float atan2Approx(float y, float x)
+{
+    float ax = qAbs(x), ay = qAbs(y);
+    float a = qMin(ax, ay) / qMax(qMax(ax, ay), FLT_MIN);
+    float s = a*a;
+    float r = a*(ATAN_C0 + s*(ATAN_C1 + s*(ATAN_C2 + s*(ATAN_C3 + s*ATAN_C4))));
+    if(ay > ax)
+        r = (float) M_PI_2 - r;
+    if(x < 0)
+        r = (float) M_PI - r;
+    return y < 0 ? -r : r;
+}
+
+void indexScalar(const float * re, const float * im, int from, int n,
+                 qint32 * idx, const IndexParams & p)
+{
+    for(int i = from; i < n; i++) {
+        float mag = log2Approx(re[i]*re[i] + im[i]*im[i])*p.log2Scale + p.offset;
+        float q = qMin(mag, 1.0f)*CMAP_VALUE_STEPS + qMax(mag - 1.0f, 0.0f)*p.satSlope;
+        q = qBound(0.0f, q, (float) (CMAP_MAG_STEPS - 1));
+        float ph = (atan2Approx(im[i], re[i]) + (float) M_PI) * PHASE_K;
+        ph = qBound(0.0f, ph, (float) (CMAP_PHASE_STEPS - 1));
+        idx[i] = (qint32) q * CMAP_PHASE_STEPS + (qint32) ph;
+    }
+}
+
+#ifdef CMAP_X86
+
+#ifdef __SSE2__
+void indexSse2(const float * re, const float * im, int n,
+               qint32 * idx, const IndexParams & p)
+{
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 pi = _mm_set1_ps((float) M_PI);
+    const __m128 qMaxV = _mm_set1_ps((float) (CMAP_MAG_STEPS - 1));
+    const __m128 pMaxV = _mm_set1_ps((float) (CMAP_PHASE_STEPS - 1));
+    int i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(re + i);
+        __m128 y = _mm_loadu_ps(im + i);
+
+        __m128 m2 = _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+        __m128i bits = _mm_castps_si128(m2);
+        __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+        __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+                                                 _mm_set1_epi32(0x3f800000)));
+        __m128 l2 = _mm_add_ps(e, _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(LOG2_C2), m),
+                                                                   _mm_set1_ps(LOG2_C1)), m),
+                                             _mm_set1_ps(LOG2_C0)));
+        __m128 mag = _mm_add_ps(_mm_mul_ps(l2, _mm_set1_ps(p.log2Scale)), _mm_set1_ps(p.offset));
+        __m128 q = _mm_add_ps(_mm_mul_ps(_mm_min_ps(mag, one), _mm_set1_ps((float) CMAP_VALUE_STEPS)),
+                              _mm_mul_ps(_mm_max_ps(_mm_sub_ps(mag, one), zero), _mm_set1_ps(p.satSlope)));
+        q = _mm_min_ps(_mm_max_ps(q, zero), qMaxV);
+
+        __m128 ax = _mm_andnot_ps(sign, x);
+        __m128 ay = _mm_andnot_ps(sign, y);
+        __m128 a = _mm_div_ps(_mm_min_ps(ax, ay), _mm_max_ps(_mm_max_ps(ax, ay), _mm_set1_ps(FLT_MIN)));
+        __m128 s = _mm_mul_ps(a, a);
+        __m128 r = _mm_add_ps(_mm_set1_ps(ATAN_C3), _mm_mul_ps(s, _mm_set1_ps(ATAN_C4)));
+        r = _mm_add_ps(_mm_set1_ps(ATAN_C2), _mm_mul_ps(s, r));
+        r = _mm_add_ps(_mm_set1_ps(ATAN_C1), _mm_mul_ps(s, r));
+        r = _mm_mul_ps(a, _mm_add_ps(_mm_set1_ps(ATAN_C0), _mm_mul_ps(s, r)));
+        __m128 steep = _mm_cmpgt_ps(ay, ax);
+        r = _mm_or_ps(_mm_and_ps(steep, _mm_sub_ps(_mm_set1_ps((float) M_PI_2), r)), _mm_andnot_ps(steep, r));
+        __m128 left = _mm_cmplt_ps(x, zero);
+        r = _mm_or_ps(_mm_and_ps(left, _mm_sub_ps(pi, r)), _mm_andnot_ps(left, r));
+        r = _mm_xor_ps(r, _mm_and_ps(_mm_cmplt_ps(y, zero), sign));
+        __m128 ph = _mm_mul_ps(_mm_add_ps(r, pi), _mm_set1_ps(PHASE_K));
+        ph = _mm_min_ps(_mm_max_ps(ph, zero), pMaxV);
+
+        __m128i qi = _mm_cvttps_epi32(q);
+        __m128i pi_ = _mm_cvttps_epi32(ph);
+        // CMAP_PHASE_STEPS is a power of two
+        __m128i out = _mm_add_epi32(_mm_slli_epi32(qi, 7), pi_);
+        _mm_storeu_si128((__m128i *) (idx + i), out);
+    }
+    indexScalar(re, im, i, n, idx, p);
+}
+#endif
+
+__attribute__((target("avx2,fma")))
+void indexAvx2(const float * re, const float * im, int n,
+               qint32 * idx, const IndexParams & p)
+{
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 pi = _mm256_set1_ps((float) M_PI);
+    const __m256 qMaxV = _mm256_set1_ps((float) (CMAP_MAG_STEPS - 1));
+    const __m256 pMaxV = _mm256_set1_ps((float) (CMAP_PHASE_STEPS - 1));
+    int i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(re + i);
+        __m256 y = _mm256_loadu_ps(im + i);
+
+        __m256 m2 = _mm256_fmadd_ps(x, x, _mm256_mul_ps(y, y));
+        __m256i bits = _mm256_castps_si256(m2);
+        __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+        __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+                                                       _mm256_set1_epi32(0x3f800000)));
+        __m256 l2 = _mm256_add_ps(e, _mm256_fmadd_ps(_mm256_fmadd_ps(_mm256_set1_ps(LOG2_C2), m,
+                                                                     _mm256_set1_ps(LOG2_C1)), m,
+                                                     _mm256_set1_ps(LOG2_C0)));
+        __m256 mag = _mm256_fmadd_ps(l2, _mm256_set1_ps(p.log2Scale), _mm256_set1_ps(p.offset));
+        __m256 q = _mm256_fmadd_ps(_mm256_min_ps(mag, one), _mm256_set1_ps((float) CMAP_VALUE_STEPS),
+                                   _mm256_mul_ps(_mm256_max_ps(_mm256_sub_ps(mag, one), zero),
+                                                 _mm256_set1_ps(p.satSlope)));
+        q = _mm256_min_ps(_mm256_max_ps(q, zero), qMaxV);
+
+        __m256 ax = _mm256_andnot_ps(sign, x);
+        __m256 ay = _mm256_andnot_ps(sign, y);
+        __m256 a = _mm256_div_ps(_mm256_min_ps(ax, ay),
+                                 _mm256_max_ps(_mm256_max_ps(ax, ay), _mm256_set1_ps(FLT_MIN)));
+        __m256 s = _mm256_mul_ps(a, a);
+        __m256 r = _mm256_fmadd_ps(s, _mm256_set1_ps(ATAN_C4), _mm256_set1_ps(ATAN_C3));
+        r = _mm256_fmadd_ps(s, r, _mm256_set1_ps(ATAN_C2));
+        r = _mm256_fmadd_ps(s, r, _mm256_set1_ps(ATAN_C1));
+        r = _mm256_mul_ps(a, _mm256_fmadd_ps(s, r, _mm256_set1_ps(ATAN_C0)));
+        r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps((float) M_PI_2), r),
+                             _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+        r = _mm256_blendv_ps(r, _mm256_sub_ps(pi, r), _mm256_cmp_ps(x, zero, _CMP_LT_OQ));
+        r = _mm256_xor_ps(r, _mm256_and_ps(y, sign));
+        __m256 ph = _mm256_mul_ps(_mm256_add_ps(r, pi), _mm256_set1_ps(PHASE_K));
+        ph = _mm256_min_ps(_mm256_max_ps(ph, zero), pMaxV);
+
+        __m256i out = _mm256_add_epi32(_mm256_slli_epi32(_mm256_cvttps_epi32(q), 7),
+                                       _mm256_cvttps_epi32(ph));
+        _mm256_storeu_si256((__m256i *) (idx + i), out);
+    }
+    indexScalar(re, im, i, n, idx, p);
+}
+
+#endif /* CMAP_X86 */
+
+typedef void (*IndexKernel)(const float *, const float *, int, qint32 *, const IndexParams &);
+
+void indexPortable(const float * re, const float * im, int n,
+                   qint32 * idx, const IndexParams & p)
+{
+    indexScalar(re, im, 0, n, idx, p);
+}
+
+IndexKernel selectKernel()
+{
+#ifdef CMAP_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return indexAvx2;
+#ifdef __SSE2__
+    return indexSse2;
+#endif
+#endif
+    return indexPortable;
+}
+
+const IndexKernel indexKernel = selectKernel();
+
+}
+
+SpectrumColormap::SpectrumColormap()
+{
+    Q_STATIC_ASSERT(CMAP_PHASE_STEPS == 128);
+    m_log2Scale = (float) (0.5 * M_LN2 / M_LN10);
+    buildLut();
+}
+
+// Value ramps 0..1 over the first CMAP_VALUE_STEPS magnitude steps (one
+// decade), then saturation fades 1..0 over the remaining steps.
+void SpectrumColormap::buildLut()
+{
+    m_lut.resize(CMAP_MAG_STEPS*CMAP_PHASE_STEPS);
+    for(int q = 0; q < CMAP_MAG_STEPS; q++) {
+        qreal v = qMin(1.0, (qreal) q / CMAP_VALUE_STEPS);
+        qreal s = 1.0 - qMax(0.0, (qreal) (q - CMAP_VALUE_STEPS) / (CMAP_SAT_STEPS - 1));
+        for(int p = 0; p < CMAP_PHASE_STEPS; p++) {
+            qreal h = ((qreal) p + 0.5) / CMAP_PHASE_STEPS;
+            m_lut[q*CMAP_PHASE_STEPS + p] = QColor::fromHsvF(h, s, v).rgb();
+        }
+    }
+}
+
+void SpectrumColormap::setParams(qreal scale, qreal sat, qreal gain)
+{
+    if(scale == m_scale && sat == m_sat && gain == m_gain)
+        return;
+    m_scale = scale;
+    m_sat = sat;
+    m_gain = gain;
+    m_offset = (float) (scale + log10(gain));
+    m_satSlope = (float) (sat * (CMAP_SAT_STEPS - 1));
+}
+
+void SpectrumColormap::mapRow(const float * re, const float * im, int n, QRgb * rgb)
+{
+    if(m_index.size() < n)
+        m_index.resize(n);
+    IndexParams p = {m_log2Scale, m_offset, m_satSlope};
+    qint32 * idx = m_index.data();
+    indexKernel(re, im, n, idx, p);
+
+    const QRgb * lut = m_lut.constData();
+    for(int i = 0; i < n; i++)
+        rgb[i] = lut[idx[i]];
+}
@@ -0,0 +1,52 @@
+//
+//  spectrum_colormap.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef spectrum_colormap_hpp
+#define spectrum_colormap_hpp
+
+#include <QtGlobal>
+#include <QVector>
+#include <QRgb>
+
+#define CMAP_PHASE_STEPS 128
+#define CMAP_VALUE_STEPS 128
+#define CMAP_SAT_STEPS 128
+#define CMAP_MAG_STEPS (CMAP_VALUE_STEPS + CMAP_SAT_STEPS)
+
+// Colormap stage of SpectrumScope: phase picks the hue, log-magnitude
+// ramps value up to 1 and then washes saturation out towards white.
+// Colors come from a lookup table indexed by quantized (magnitude, phase);
+// the per-pixel work is an approximate log2 and atan2, vectorized where
+// the CPU allows.
+class SpectrumColormap {
+public:
+    SpectrumColormap();
+
+    // `gain` is the linear normalization applied to every magnitude.
+    // Rebuilds the index mapping only when something changed.
+    void setParams(qreal scale, qreal sat, qreal gain);
+
+    // Maps n planar complex samples to RGB32 pixels.
+    void mapRow(const float * re, const float * im, int n, QRgb * rgb);
+
+private:
+    void buildLut();
+
+    QVector<QRgb> m_lut;            // [mag][phase] 0xffRRGGBB
+    QVector<qint32> m_index;        // per-row scratch
+    qreal m_scale = -1e9;
+    qreal m_sat = -1.0;
+    qreal m_gain = -1.0;
+
+    // mag = log2(|z|^2)*m_log2Scale + m_offset, then
+    // index = min(mag,1)*VALUE_STEPS + max(mag-1,0)*m_satSlope
+    float m_log2Scale;
+    float m_offset = 0;
+    float m_satSlope = 0;
+};
+
+#endif /* spectrum_colormap_hpp */
@@ -10,205 +10,454 @@
 #include <QPainter>
 #include <QPaintEvent>
 #include <QWheelEvent>
+#include <QtConcurrent>
 
 #include "spectrum_scope.hpp"
-#include <fftw3.h>
 
-SpectrumScope::SpectrumScope(QWidget *parent) : RasterImage(parent)
+template<typename Real>
+SpectrumScopeT<Real>::SpectrumScopeT(QWidget *parent) : RasterImage(parent)
 {
     m_X = rect().width();
     m_Y = rect().height();
-    m_W = qMax(m_X,m_Y);
-    m_W += m_W % 2;
-    m_N = m_W * m_W;
     
-    pre   = (std::complex<double> *) fftw_alloc_complex(FRAME_SIZE);
-    decim = (std::complex<double> *) fftw_alloc_complex(FRAME_SIZE);
-    
-    prePlan = fftw_plan_dft_1d(FRAME_SIZE,
-                               reinterpret_cast<fftw_complex *>(pre),
-                               reinterpret_cast<fftw_complex *>(decim),
-                               FFTW_FORWARD, FFTW_MEASURE);
-    fft_dyn_alloc();
-    fftw_init_threads();
-    fftw_plan_with_nthreads(2);
+    m_stft.setHop(len() / m_params.stftHops);
+    fft_replan();
+    m_uiX = m_X;
 }
 
 
- void SpectrumScope::fft_decim_set() {
-     in_r = in;
-     in_w = in + (m_W/2-m_scanLines/2)*m_W;
-     memset(in, 0, m_N*sizeof(std::complex<double>));
+ template<typename Real>
+ void SpectrumScopeT<Real>::fft_decim_set() {
+     m_lines.fill(0, m_params.scanLines * m_params.inputSamples);
+     m_line = 0;
+     m_resync = true;
+ }
+ 
+ // Runs on a pool thread. Plans for a size seen before, say the one the
+ // window is being dragged back to, come straight from the cache.
+ template<typename Real>
+ typename SpectrumScopeT<Real>::Plane * SpectrumScopeT<Real>::fft_plan(quint32 W) {
+     Plane * p = new Plane;
+     p->W = W;
+     p->roots = FFTW<Real>::alloc_complex(W);
+     for(quint32 j = 0; j < W; j++)
+         p->roots[j] = std::polar((Real) 1, (Real) (-2.0*M_PI*j/W));
      
+     FftCache<Real> & cache = FftCache<Real>::instance();
+     p->decimPlan = cache.acquire(FftPlan<Real>::Backward, W);
+     p->inPlan    = cache.acquire(FftPlan<Real>::Forward2D, W);
+     p->rowPlan   = cache.acquire(FftPlan<Real>::Forward, W);
+     return p;
+ }
+ 
+ template<typename Real>
+ typename SpectrumScopeT<Real>::Plane SpectrumScopeT<Real>::plane() const {
+     Plane p;
+     p.W = m_W;
+     p.roots = roots;
+     p.decimPlan = decimPlan; p.inPlan = inPlan; p.rowPlan = rowPlan;
+     return p;
  }
  
- void SpectrumScope::fft_dyn_alloc() {
-     if(in != NULL)
-         fftw_free(in);
-     in   = (std::complex<double> *) fftw_alloc_complex(m_N);
-
-     if(out != NULL)
-         fftw_free(out);
-     out   = (std::complex<double> *) fftw_alloc_complex(m_N);
+ template<typename Real>
+ void SpectrumScopeT<Real>::fft_free(const Plane & p) {
+     FftCache<Real> & cache = FftCache<Real>::instance();
+     cache.release(p.decimPlan);
+     cache.release(p.inPlan);
+     cache.release(p.rowPlan);
+     FFTW<Real>::free(p.roots);
+ }
+ 
+ // Worker side, at a frame boundary: swap in a finished plane, releasing
+ // the one it replaces.
+ template<typename Real>
+ void SpectrumScopeT<Real>::fft_adopt(Plane * p) {
+     fft_free(plane());
      
-     if(post != NULL)
-         fftw_free(post);
-     post = (std::complex<double> *) fftw_alloc_complex(m_W);
-     fft_decim_set();
-
-     decimPlan = fftw_plan_dft_1d(m_W,
-                                  reinterpret_cast<fftw_complex*>(decim),
-                                  reinterpret_cast<fftw_complex*>(post),
-                                          FFTW_BACKWARD, FFTW_MEASURE);
+     roots = p->roots;
+     decimPlan = p->decimPlan; inPlan = p->inPlan; rowPlan = p->rowPlan;
+     decim = decimPlan->in; post = decimPlan->out;
+     out = inPlan->out;
+     row_d = rowPlan->in; row_f = rowPlan->out;
+     m_W = p->W;
+     delete p;
      
-     inPlan = fftw_plan_dft_2d(m_W, m_W,
-                 reinterpret_cast<fftw_complex*>(out),
-                 reinterpret_cast<fftw_complex*>(out),
-                     FFTW_FORWARD, FFTW_MEASURE);
-  }
+     m_params.scanLines = qMin(m_params.scanLines, m_W);
+     m_params.inputSamples = qMin(m_params.inputSamples, m_W);
+     m_trigger.setLength(m_W);
+     m_trigger.setSettings(triggerSettings());
+     m_planeSize.storeRelaxed(m_W);
+     fft_decim_set();
+     colormap_set();
+ }
  
+ // Keeps the plane sized to the image. A plane for a new size is built in
+ // the background; the current one keeps rendering until it is adopted.
+ template<typename Real>
+ void SpectrumScopeT<Real>::fft_replan() {
+     if(m_planPending) {
+         if(!offline() && !m_planning.isFinished())
+             return;
+         m_planPending = false;
+         fft_adopt(m_planning.result());
+     }
+     quint32 W = qMax(m_X, m_Y);
+     W += W % 2;
+     if(W == 0 || W == m_W)
+         return;
+     if(offline()) {
+         // headless renders have nothing to show in the meantime
+         fft_adopt(fft_plan(W));
+         return;
+     }
+     if(m_W == 0)
+         m_planeSize.storeRelaxed(W);
+     m_planning = QtConcurrent::run([W]() { return fft_plan(W); });
+     m_planPending = true;
+ }
+
+
+template<typename Real>
+SpectrumScopeT<Real>::~SpectrumScopeT()
+{
+    quit();
+    if(m_planPending) {
+        m_planning.waitForFinished();
+        Plane * p = m_planning.result();
+        fft_free(*p);
+        delete p;
+    }
+    fft_free(plane());
+}
+
+template<typename Real>
+void SpectrumScopeT<Real>::applyParams()
+{
+    Params p;
+    if(m_paramBox.fetch(p)) {
+        // the GUI bounds these by the plane it last saw, which may have
+        // been replaced by a smaller one since
+        if(m_W != 0) {
+            p.scanLines = qMin(p.scanLines, m_W);
+            p.inputSamples = qMin(p.inputSamples, m_W);
+        }
+        bool reset = p.scanLines != m_params.scanLines
+                  || p.inputSamples != m_params.inputSamples;
+        const bool rearm = p.rearms != m_params.rearms;
+        m_params = p;
+        m_trigger.setSettings(triggerSettings());
+        if(rearm)
+            m_trigger.rearm();
+        if(reset && m_W != 0)
+            fft_decim_set();
+        m_stft.setWindow((typename Stft<Real>::Window) p.window);
+        m_stft.setHop(len() / p.stftHops);
+        m_zoom.setWindow((typename Stft<Real>::Window) p.window);
+        m_zoom.setHop(len() / p.stftHops);
+        // a new band starts from silence, so refill from the whole window
+        const quint32 D = m_zoom.decimation();
+        const qreal center = m_zoom.center();
+        m_zoom.setBand(p.zoomCenter, p.zoomDecimation, sampleRate());
+        if(m_zoom.decimation() != D || m_zoom.center() != center)
+            m_stftPrimed = false;
+    }
+    fft_replan();
+}
+
+// Rows trigger on their power, so the level squares into a threshold
+// once here rather than taking a log10 per sample.
+template<typename Real>
+typename Trigger<Real>::Settings SpectrumScopeT<Real>::triggerSettings() const
+{
+    const Params & p = m_params;
+    typename Trigger<Real>::Settings s;
+    s.edge = p.triggerEdge;
+    s.mode = p.triggerMode;
+    s.source = Trigger<Real>::Power;
+    s.level = (Real) qPow(10.0, 2*p.trigger_level);
+    s.hysteresis = s.level - (Real) qPow(10.0, 2*(p.trigger_level - SPECTRUM_TRIGGER_HYSTERESIS));
+    s.pretrigger = (quint32) (p.pretrigger * m_W);
+    return s;
+}
+
+// A new frame size or rate restarts both transforms on fresh history.
+template<typename Real>
+void SpectrumScopeT<Real>::postFormat()
+{
+    m_stft.setSize(len());
+    m_stft.setHop(len() / m_params.stftHops);
+    m_zoom.setSize(len());
+    m_zoom.setHop(len() / m_params.stftHops);
+    m_zoom.setBand(m_params.zoomCenter, m_params.zoomDecimation, sampleRate());
+    m_stftPrimed = false;
+    // the lines may hold fewer bins now
+    if(m_W != 0)
+        fft_decim_set();
+}
 
-SpectrumScope::~SpectrumScope()
+// Input from before the start doesn't join up with what follows, so both
+// transforms forget their history and refill from the whole window.
+template<typename Real>
+void SpectrumScopeT<Real>::postStart()
 {
-    fftw_destroy_plan(prePlan);
-    fftw_destroy_plan(decimPlan);
-    fftw_destroy_plan(inPlan);
-    fftw_free((fftw_complex*)in);
-    fftw_free((fftw_complex*)out);
-    fftw_free((fftw_complex*)decim);
-    fftw_free((fftw_complex*)post);
-    fftw_cleanup_threads();
+    m_stft.reset();
+    m_zoom.reset();
+    m_stftPrimed = false;
 }
 
-void SpectrumScope::refreshImpl()
+// Each refresh feeds the samples new since the last one to the STFT, or
+// the zoom FFT when zoomed in, and every spectrum that completes becomes
+// one scan line.
+template<typename Real>
+void SpectrumScopeT<Real>::refreshImpl()
 {
-    int M = qMin((quint32) FRAME_SIZE, len());
+    if(out == NULL)
+        return;
+    const quint32 M = len();
+    const quint32 fresh = m_stftPrimed ? qMin(hop(), M) : M;
+    m_stftPrimed = true;
+    stage(StageClock::Setup);
 
-    for(int32_t n = 0; n < M/2 ; n++) {
-        pre[n] = (double) data()[n] / 32768.0;
-        pre[FRAME_SIZE-n-1] = (double) data()[M-n-1] / 32768.0;
+    const bool zoom = m_zoom.decimation() > 1;
+    const int rows = zoom ? m_zoom.push(data() + M - fresh, fresh)
+                          : m_stft.push(data() + M - fresh, fresh);
+    stage(StageClock::FFT);
+    if(rows == 0) {
+        // nothing new to show
+        setDirty(QRect());
+        return;
+    }
+    for(int r = 0; r < rows; r++)
+        scan_row(zoom ? m_zoom.spectrum(r) : m_stft.spectrum(r), !zoom);
+
+    if(m_resync || m_sinceResync >= SPECTRUM_RESYNC_FRAMES) {
+        // the plane is the scan lines at their shifted places, zero elsewhere
+        const quint32 J = lineSamples();
+        memset(out, 0, (size_t) m_W * m_W * sizeof(std::complex<Real>));
+        for(quint32 line = 0; line < m_params.scanLines; line++) {
+            const std::complex<Real> * l = m_lines.constData() + (size_t) line * m_params.inputSamples;
+            std::complex<Real> * o = out + (size_t) shiftedRow(line) * m_W;
+            for(quint32 j = 0; j < J; j++)
+                o[shiftedColumn(j, J)] = l[j];
+        }
+        inPlan->execute();
+        m_resync = false;
+        m_sinceResync = 0;
     }
+    stage(StageClock::FFT2D);
     
-    fftw_execute(prePlan);
-    for(quint32 n = 0; n < m_inputSamples*FRAME_SIZE/M/2; n++) {
-        decim[n] = decim[n*(FRAME_SIZE/M)];
-        decim[m_inputSamples*(FRAME_SIZE/M)-n-1] = decim[FRAME_SIZE-(n*(FRAME_SIZE/M)+1)];
+    // Normalization folds into the colormap's log offset. Rows are
+    // gathered through the fft-shift into planar floats and mapped
+    // straight into the scanline.
+    m_colormap.setParams(m_params.scale, m_params.sat,
+                         1.0 / ((double) m_params.scanLines * (double) m_params.inputSamples));
+    const quint32 y_step = qMax(1U, m_W/m_Y);
+    for(quint32 y_ = 0; y_ < m_Y; y_++) {
+        quint32 y = (y_ + m_Y - m_Y/2) % m_Y;
+        const std::complex<Real> * row = out + ((y * y_step) % m_W) * m_W;
+        for(quint32 x_ = 0; x_ < m_X; x_++) {
+            const std::complex<Real> & z = row[m_colIndex[x_]];
+            m_re[x_] = (float) real(z);
+            m_im[x_] = (float) imag(z);
+        }
+        m_colormap.mapRow(m_re.constData(), m_im.constData(), m_X,
+                          reinterpret_cast<QRgb *>(scanLine(y_)));
+    }
+    setDirty(QRect(0, 0, m_X, m_Y));
+    stage(StageClock::Colormap);
+}
+
+// One spectrum into the scan lines: keep the inputSamples bins around
+// bin 0, back to time, trigger, and write it over the oldest line. A half
+// spectrum is an r2c one; otherwise all len() bins are there, the
+// negative ones in the upper half.
+template<typename Real>
+void SpectrumScopeT<Real>::scan_row(const std::complex<Real> * spectrum, bool halfSpectrum)
+{
+    // a held single shot keeps the plane as it was
+    if(m_trigger.held())
+        return;
+    // a plane wider than the frame has more columns than there are bins
+    const quint32 I = qMin(m_params.inputSamples, len());
+    for(quint32 n = 0; n < I/2; n++) {
+        decim[n] = spectrum[n];
+        // the negative bins of a real signal's spectrum mirror the positive
+        decim[I-n-1] = halfSpectrum ? conj(spectrum[n+1]) : spectrum[len()-n-1];
     }
+    if(I % 2)
+        decim[I/2] = spectrum[I/2];
 
-    quint32 x_offset = m_W/2 - m_inputSamples/2;
-    memset(decim + m_inputSamples*(FRAME_SIZE/M), 0,
-           (FRAME_SIZE-m_inputSamples*(FRAME_SIZE/M))*sizeof(std::complex<double>));
+    memset(decim + I, 0, (m_W-I)*sizeof(std::complex<Real>));
     
-    fftw_execute(decimPlan);
+    decimPlan->execute();
     
     for(quint32 m = 0; m < m_W; m++) {
-        post[m] /= (double) m_inputSamples;
+        post[m] /= (Real) I;
     }
+    stage(StageClock::Decimate);
 
-    qint32 trigger_offset = -1;
-    for(quint32 m = 0; m < m_W ; m++) {
-        if(trigger_offset < 0 && log10(abs(post[m])) >= trigger_level && arg(post[m]) >= 0.0) {
-            trigger_offset = m;
-            break;
-        }
-    }
-    
-    if(trigger_offset >= 0 && trigger_offset < (int)m_W-1) {
-        memcpy(post,
-               post + trigger_offset,
-               (m_W - trigger_offset)
-                    *sizeof(std::complex<double>));
-        memset(post+m_W - trigger_offset, 0, trigger_offset*sizeof(std::complex<double>));
-    } else if(trigger_offset < 0) {
-        memset(post, 0, m_W*sizeof(std::complex<double>));
-    }
+    // Each row triggers on its own: from silence, and padded out with it,
+    // so a late trigger shifts the row left over zeros.
+    m_trigger.reset();
+    m_trigger.push(post, m_W);
+    m_trigger.pad(m_W);
+    const std::complex<Real> * triggered = m_trigger.window();
+    stage(StageClock::Trigger);
     
-    memset(in_w, 0, m_W*sizeof(std::complex<double>));
-    for(quint32 n = x_offset, m = 0;
-            n < m_W-x_offset && m < m_W;
-            n++,
-            (m+=m_W/m_inputSamples)%=m_W) {
-        in_w[n] =  post[m];
+    // Take every W/I-th sample into the oldest line, and keep the
+    // difference, at its shifted columns, so the plane's spectrum can be
+    // updated with just that.
+    const quint32 J = lineSamples();
+    std::complex<Real> * line = m_lines.data() + (size_t) m_line * m_params.inputSamples;
+    memset(row_d, 0, m_W*sizeof(std::complex<Real>));
+    for(quint32 j = 0, m = 0; j < J; j++, (m += m_W/I) %= m_W) {
+        const std::complex<Real> v = triggered != NULL ? triggered[m] : 0;
+        row_d[shiftedColumn(j, J)] = v - line[j];
+        line[j] = v;
     }
-    in_r = in;
-    in_w = in_r + (m_W/2-m_scanLines/2)*m_W
-                + (((in_w - (in_r + (m_W/2-m_scanLines/2)*m_W)) + m_W) % (m_scanLines*m_W));
-
-    for(quint32 y = 0; y < m_W; y++) {
-        for(quint32 x = 0; x < m_W; x++) {
-            quint32 x_ = (x+m_W/2) % m_W;
-            quint32 y_ = (y+m_W/2) % m_W;
-            out[y*m_W+x] = in[y_*m_W+x_];
-        }
-    }
-    fftw_execute(inPlan)    ;
+    const quint32 y = shiftedRow(m_line);
+    m_line = (m_line + 1) % m_params.scanLines;
+
+    // a pending full recompute supersedes the incremental update
+    if(!m_resync && ++m_sinceResync < SPECTRUM_RESYNC_FRAMES)
+        fft_row_update(y);
+    stage(StageClock::FFT2D);
+}
+
+// The 2D DFT is linear and separable, so replacing one row of the plane
+// changes its spectrum by a rank-one term: the row's 1D spectrum times a
+// column twiddle for the row's (shifted) position y.
+template<typename Real>
+void SpectrumScopeT<Real>::fft_row_update(quint32 y) {
+    rowPlan->execute();
     
-    for(quint32 n = 0; n < m_N ; n++) {
-        out[n] /= (double) m_scanLines * (double) m_inputSamples;
+    for(quint32 k = 0; k < m_W; k++) {
+        const std::complex<Real> t = roots[(quint64) k * y % m_W];
+        std::complex<Real> * o = out + k*m_W;
+        for(quint32 l = 0; l < m_W; l++)
+            o[l] += t * row_f[l];
     }
-    
-    for(quint32 x = 0; x < m_X ; x++) {
-        for(quint32 y = 0; y < m_Y ; y++) {
-            int x_plane = (x * qMax(1U,m_W/m_X)) % m_W;
-            int y_plane = (y * qMax(1U,m_W/m_Y)) % m_W;
-            int x_ = (x+m_X/2) % m_X;
-            int y_ = (y+m_Y/2) % m_Y;
-            double mag = log10(abs(out[y_plane*m_W+x_plane])) + scale;
-            
-            QColor color;
-            color.setHsvF((arg(out[y_plane*m_W+x_plane])+M_PI)/(2*M_PI),
-                    1.0 - qBound(0.0,
-                                 qMax((mag-1.0)*sat,0.0),
-                                 1.0),
-                          qBound(0.0, mag, 1.0));
-            setPixelColor(x_, y_, color);
-        }
+}
+
+template<typename Real>
+void SpectrumScopeT<Real>::colormap_set() {
+    const quint32 x_step = qMax(1U, m_W/m_X);
+    m_colIndex.resize(m_X);
+    m_re.resize(m_X);
+    m_im.resize(m_X);
+    if(m_W == 0)
+        return;
+    for(quint32 x_ = 0; x_ < m_X; x_++) {
+        quint32 x = (x_ + m_X - m_X/2) % m_X;
+        m_colIndex[x_] = (x * x_step) % m_W;
     }
 }
 
 
-void SpectrumScope::postResize() {
-    if(m_X != (quint32) rect().width())
+template<typename Real>
+void SpectrumScopeT<Real>::preResize(const QSize & size) {
+    if(m_uiX != (quint32) size.width())
     {
-        m_inputSamples = qBound(1U, m_inputSamples + (m_X - rect().width()), m_W);
+        m_ui.inputSamples = qBound(1U, m_ui.inputSamples + (m_uiX - size.width()), m_planeSize.loadRelaxed());
+        postParams();
         setBandwidthTitle();
     }
+    m_uiX = size.width();
+}
+
+template<typename Real>
+void SpectrumScopeT<Real>::postResize() {
     m_X = rect().width();
     m_Y = rect().height();
+    colormap_set();
 }
 
-void SpectrumScope::wheelEvent(QWheelEvent *ev)
+
+template<typename Real>
+void SpectrumScopeT<Real>::wheelEvent(QWheelEvent *ev)
 {
-    if(QApplication::queryKeyboardModifiers().testFlag(Qt::ShiftModifier)) {
+    if(QApplication::queryKeyboardModifiers().testFlag(Qt::ControlModifier) &&
+       QApplication::queryKeyboardModifiers().testFlag(Qt::ShiftModifier)) {
+        // zoom: vertical moves the centre a tenth of the shown band,
+        // horizontal halves or doubles the band
+        const qreal band = (qreal) m_ui.inputSamples * sampleRate() / len() / m_ui.zoomDecimation;
+        if(ev->angleDelta().y() > 0.0)
+            m_ui.zoomCenter += qMax(1.0, band / 10);
+        else if(ev->angleDelta().y() < 0.0)
+            m_ui.zoomCenter -= qMax(1.0, band / 10);
+        m_ui.zoomCenter = qBound(0.0, m_ui.zoomCenter, sampleRate() / 2.0);
+        
+        if(ev->angleDelta().x() > 0.0)
+            m_ui.zoomDecimation *= 2;
+        else if(ev->angleDelta().x() < 0.0)
+            m_ui.zoomDecimation /= 2;
+        m_ui.zoomDecimation = qBound(1U, m_ui.zoomDecimation, (quint32) ZOOM_MAX_DECIMATION);
+        setZoomTitle();
+    } else if(QApplication::queryKeyboardModifiers().testFlag(Qt::ShiftModifier)) {
+        if(ev->angleDelta().y() > 0.0)
+            m_ui.scale += .01;
+        else if(ev->angleDelta().y() < 0.0)
+            m_ui.scale -= .01;
+        
+        if(ev->angleDelta().x() > 0.0)
+            m_ui.sat = qBound(0.00, m_ui.sat+.01, 1.0);
+        else if(ev->angleDelta().x() < 0.0)
+            m_ui.sat = qBound(0.00, m_ui.sat-.01, 1.0);
+        setTitle(QString("[Scale: %1 dB] [Sat.: %2]").arg(m_ui.scale*10).arg(m_ui.sat));
+    } else if(QApplication::queryKeyboardModifiers().testFlag(Qt::ControlModifier)) {
         if(ev->angleDelta().y() > 0.0)
-            scale += .01;
+            m_ui.window = (m_ui.window + 1) % Stft<Real>::WindowCount;
         else if(ev->angleDelta().y() < 0.0)
-            scale -= .01;
+            m_ui.window = (m_ui.window + Stft<Real>::WindowCount - 1) % Stft<Real>::WindowCount;
         
+        // fewer hops per frame is a longer hop
         if(ev->angleDelta().x() > 0.0)
-            sat = qBound(0.00, sat+.01, 1.0);
+            m_ui.stftHops /= 2;
         else if(ev->angleDelta().x() < 0.0)
-            sat = qBound(0.00, sat-.01, 1.0);
-        QApplication::activeWindow()->setWindowTitle(QString("[Scale: %1 dB] [Sat.: %2]").arg(scale*10).arg(sat));
+            m_ui.stftHops *= 2;
+        m_ui.stftHops = qBound(1U, m_ui.stftHops, (quint32) STFT_MAX_BATCH);
+        setTitle(QString("[Window: %1] [Hop: %2]").arg(Stft<Real>::windowName(m_ui.window)).arg(len() / m_ui.stftHops));
     } else if(QApplication::queryKeyboardModifiers().testFlag(Qt::AltModifier)) {
         if(ev->angleDelta().y() > 0.0)
-            m_scanLines += 1;
+            m_ui.scanLines += 1;
         else if(ev->angleDelta().y() < 0.0)
-            m_scanLines -= 1;
-        m_scanLines = qBound(1U, m_scanLines, m_W);
+            m_ui.scanLines -= 1;
+        m_ui.scanLines = qBound(1U, m_ui.scanLines, m_planeSize.loadRelaxed());
         
         if(ev->angleDelta().x() > 0.0)
-            m_inputSamples += 1;
+            m_ui.inputSamples += 1;
         else if(ev->angleDelta().x() < 0.0)
-            m_inputSamples -= 1;
-        m_inputSamples = qBound(1U, m_inputSamples, m_W);
-        fft_decim_set();
+            m_ui.inputSamples -= 1;
+        m_ui.inputSamples = qBound(1U, m_ui.inputSamples, m_planeSize.loadRelaxed());
         setBandwidthTitle();
     } else {
         if(ev->angleDelta().y() > 0.0)
-            trigger_level += .01;
+            m_ui.trigger_level += .01;
         else if(ev->angleDelta().y() < 0.0)
-            trigger_level -= .01    ;
-        QApplication::activeWindow()->setWindowTitle(QString("[Trigger: %1 dB]").arg(trigger_level*10));
+            m_ui.trigger_level -= .01    ;
+        
+        if(ev->angleDelta().x() > 0.0)
+            m_ui.pretrigger += .05;
+        else if(ev->angleDelta().x() < 0.0)
+            m_ui.pretrigger -= .05;
+        m_ui.pretrigger = qBound(0.0, m_ui.pretrigger, 0.9);
+        setTitle(QString("[Trigger: %1 dB] [Pre-trigger: %2%]")
+                 .arg(m_ui.trigger_level*10).arg(qRound(m_ui.pretrigger * 100)));
     }
+    postParams();
 }
+
+// The worker clamps too; this keeps the GUI's copy, and so the readouts,
+// in step with a plane that shrank.
+template<typename Real>
+void SpectrumScopeT<Real>::postParams()
+{
+    const quint32 W = m_planeSize.loadRelaxed();
+    if(W != 0) {
+        m_ui.scanLines = qMin(m_ui.scanLines, W);
+        m_ui.inputSamples = qMin(m_ui.inputSamples, W);
+    }
+    m_paramBox.post(m_ui);
+}
+
+template class SpectrumScopeT<scope_real>;
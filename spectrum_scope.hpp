@@ -9,50 +9,155 @@
 #define spectrum_view_hpp
 
 #include <complex>
+#include <QFuture>
 #include <qmath.h>
-#include <fftw3.h>
+#include "fftw_traits.hpp"
 #include "raster_image.hpp"
+#include "spectrum_colormap.hpp"
+#include "stft.hpp"
+#include "zoom_fft.hpp"
+#include "trigger.hpp"
 
-class SpectrumScope : public RasterImage {
+// full recompute of the scan plane's 2D FFT every this many frames, to
+// bound the drift of the incremental updates
+#define SPECTRUM_RESYNC_FRAMES 256
+// a row's trigger rearms this far below the level, in decades
+#define SPECTRUM_TRIGGER_HYSTERESIS 0.1
+
+// Real picks the DSP precision (float or double), see fftw_traits.hpp.
+template<typename Real>
+class SpectrumScopeT : public RasterImage {
 public:
-    explicit SpectrumScope(QWidget * parent);
-    ~SpectrumScope();
+    explicit SpectrumScopeT(QWidget * parent);
+    ~SpectrumScopeT();
     
+    void preResize(const QSize & size) override;
     void postResize() override;
     void wheelEvent(QWheelEvent *ev) override;
+    // enough frames to fill the scan lines, one per STFT hop
+    quint32 historyFrames() const override {
+        return (m_params.scanLines * (len() / m_params.stftHops) + hop() - 1) / hop() + 1;
+    }
+    // GUI side: see Trigger
+    void setTriggerEdge(int edge) {
+        m_ui.triggerEdge = edge;
+        postParams();
+    }
+    void setTriggerMode(int mode) {
+        m_ui.triggerMode = mode;
+        postParams();
+    }
+    // lets a single shot fire again
+    void rearmTrigger() {
+        m_ui.rearms++;
+        postParams();
+    }
 protected:
     void refreshImpl() override;
+    void applyParams() override;
+    void postFormat() override;
+    void postStart() override;
     
 private:
+    struct Params {
+        qreal scale = 0.0;
+        qreal sat = 0.5;
+        qreal trigger_level = 1.0;      // log10 of the magnitude
+        qreal pretrigger = 0.0;         // of the row
+        int triggerEdge = Trigger<Real>::Rising;
+        int triggerMode = Trigger<Real>::Normal;
+        quint32 rearms = 0;
+        quint32 scanLines = INIT_SIZE/PIXEL_SCALE/4;
+        quint32 inputSamples = 3*INIT_SIZE/PIXEL_SCALE/4;
+        int window = Stft<Real>::Hann;
+        quint32 stftHops = 2;           // STFT hops per frame
+        qreal zoomCenter = 1000.0;      // Hz
+        quint32 zoomDecimation = 1;     // 1 shows the full band
+    };
+    Params m_ui;        // edited on the GUI thread
+    Params m_params;    // in effect on the worker
+    Mailbox<Params> m_paramBox;
+    quint32 m_uiX = 0;
+    QAtomicInteger<quint32> m_planeSize;
+    // GUI side: posts m_ui, held to the plane adopted since it was edited
+    void postParams();
     
-    std::complex<double> *pre = NULL, *decim = NULL, *post = NULL, *in = NULL, *out = NULL;
-    std::complex<double> *in_w = NULL, *in_r = NULL;
+    Stft<Real> m_stft{BASE_FRAME_SIZE};
+    ZoomFft<Real> m_zoom{BASE_FRAME_SIZE};
+    bool m_stftPrimed = false;
+    Trigger<Real> m_trigger;
+    typename Trigger<Real>::Settings triggerSettings() const;
+    std::complex<Real> *decim = NULL, *post = NULL, *out = NULL;
+    std::complex<Real> *row_d = NULL, *row_f = NULL, *roots = NULL;
     
-    fftw_plan prePlan, decimPlan, inPlan;
+    // The scan lines proper: scanLines rows of inputSamples, written in
+    // turn. Only these are ever non-zero in the W x W plane, where they
+    // sit centred, so the plane itself is never stored.
+    QVector<std::complex<Real> > m_lines;
+    quint32 m_line = 0;                 // the next one to overwrite
+    quint32 lineSamples() const {return 2 * (qMin(m_params.inputSamples, len()) / 2);}
+    // Where row `line` and column `j` of the scan lines land in the
+    // plane once fft-shifted, so centred on 0 and wrapping.
+    quint32 shiftedRow(quint32 line) const {
+        const quint32 S = m_params.scanLines;
+        return line < S/2 ? m_W - S/2 + line : line - S/2;
+    }
+    quint32 shiftedColumn(quint32 j, quint32 J) const {
+        return j < J/2 ? m_W - J/2 + j : j - J/2;
+    }
+    
+    // Buffers and plans sized by the plane width, built off the worker.
+    // The plans come from FftCache and bring their buffers: out is the
+    // 2D plan's, decim/post the decimation's, row_d/row_f the row plan's.
+    struct Plane {
+        quint32 W = 0;
+        std::complex<Real> *roots = NULL;
+        FftPlan<Real> *decimPlan = NULL, *inPlan = NULL, *rowPlan = NULL;
+    };
+    FftPlan<Real> *decimPlan = NULL, *inPlan = NULL, *rowPlan = NULL;
+    QFuture<Plane *> m_planning;
+    bool m_planPending = false;
+    bool m_resync = true;
+    quint32 m_sinceResync = 0;
     
     quint32 m_X = 0;
     quint32 m_Y = 0;
-    quint32 m_N = 0;
     quint32 m_W = 0;
     
-    qreal scale = 0.0;
-    qreal sat = 0.5;
-    qreal trigger_level = 1.0;
-    quint32 m_scanLines = INIT_SIZE/PIXEL_SCALE/4;
-    quint32 m_inputSamples = 3*INIT_SIZE/PIXEL_SCALE/4;
+    SpectrumColormap m_colormap;
+    QVector<quint32> m_colIndex;
+    QVector<float> m_re, m_im;
     
-    void fft_dyn_alloc();
+    static Plane * fft_plan(quint32 W);
+    static void fft_free(const Plane & p);
+    Plane plane() const;
+    void fft_adopt(Plane * p);
+    void fft_replan();
     void fft_decim_set();
+    void fft_row_update(quint32 y);
+    void scan_row(const std::complex<Real> * spectrum, bool halfSpectrum);
+    void colormap_set();
     void setBandwidthTitle() {
-        QApplication::activeWindow()
-          ->setWindowTitle(
+        setTitle(
           QString().asprintf(
             "[∆ƒ (H): %'d Hz] [∆T (V): %'d ms]",
-              (int) ((double) m_inputSamples *
-                ((double)SAMPLE_RATE/ (double)FRAME_SIZE)),
-              (int) ((double) m_scanLines *
-                (double)FRAME_SIZE
-                     /((double)SAMPLE_RATE / 1000.0))));
+              (int) ((double) m_ui.inputSamples *
+                ((double)sampleRate()/ (double)len() / m_ui.zoomDecimation)),
+              (int) ((double) m_ui.scanLines *
+                (double)(len() / m_ui.stftHops)
+                     /((double)sampleRate() / 1000.0))));
+    }
+    void setZoomTitle() {
+        if(m_ui.zoomDecimation <= 1) {
+            setTitle("[Zoom: off]");
+            return;
+        }
+        const double half = m_ui.inputSamples / 2.0 * sampleRate() / len() / m_ui.zoomDecimation;
+        setTitle(QString().asprintf("[Zoom: %'d–%'d Hz] [×%u]",
+                                    (int) qMax(0.0, m_ui.zoomCenter - half),
+                                    (int) (m_ui.zoomCenter + half), m_ui.zoomDecimation));
     }
 };
+
+typedef SpectrumScopeT<scope_real> SpectrumScope;
 #endif /* spectrum_view_hpp */
@@ -0,0 +1,71 @@
+//
+//  stage_clock.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef stage_clock_hpp
+#define stage_clock_hpp
+
+#include <QElapsedTimer>
+#include <cstring>
+
+// Splits the time spent in refreshImpl() across its stages. begin()
+// starts a frame and every mark(stage) charges the time since the last
+// mark to that stage; add() charges work timed outside the frame, such as
+// the ingest() that feeds it. Single-threaded: owned by whoever drives
+// the scope.
+class StageClock {
+public:
+    enum Stage {
+        Ingest,     // raw PCM to working precision, on the capture side; see add()
+        Setup,      // per-frame bookkeeping before the transforms
+        FFT,        // 1D transforms of the frame
+        Decimate,   // SpectrumScope bandwidth decimation
+        Trigger,    // trigger search and alignment
+        FFT2D,      // SpectrumScope scan plane transform
+        Colormap,   // SpectrumScope plane to pixels
+        Raster,     // AnalyticScope trace to pixels
+        Count
+    };
+
+    static const char * name(int stage) {
+        static const char * names[Count] = {
+            "ingest", "setup", "fft", "decimate", "trigger", "fft2d", "colormap", "raster"
+        };
+        return names[stage];
+    }
+
+    StageClock() {
+        m_timer.start();
+        reset();
+    }
+
+    void reset() {
+        memset(m_ns, 0, sizeof(m_ns));
+        m_frames = 0;
+    }
+    void begin() {
+        m_last = m_timer.nsecsElapsed();
+        m_frames++;
+    }
+    void mark(int stage) {
+        qint64 t = m_timer.nsecsElapsed();
+        m_ns[stage] += t - m_last;
+        m_last = t;
+    }
+
+    void add(int stage, qint64 ns) {m_ns[stage] += ns;}
+
+    qint64 ns(int stage) const {return m_ns[stage];}
+    qint64 frames() const {return m_frames;}
+
+private:
+    QElapsedTimer m_timer;
+    qint64 m_last = 0;
+    qint64 m_ns[Count];
+    qint64 m_frames;
+};
+
+#endif /* stage_clock_hpp */
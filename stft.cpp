@@ -0,0 +1,171 @@
+//
+//  stft.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <cstring>
+#include <qmath.h>
+#include "stft.hpp"
+
+namespace {
+
+// zeroth-order modified Bessel function of the first kind, by its series
+double besselI0(double x)
+{
+    double sum = 1, term = 1;
+    for(int k = 1; k < 64 && term > sum * 1e-12; k++) {
+        term *= (x / (2*k)) * (x / (2*k));
+        sum += term;
+    }
+    return sum;
+}
+
+}
+
+template<typename Real>
+const char * Stft<Real>::windowName(int window)
+{
+    static const char * names[WindowCount] = {"Hann", "Blackman-Harris", "Kaiser"};
+    return names[window];
+}
+
+template<typename Real>
+Stft<Real>::Stft(quint32 size) : m_size(size), m_hop(size)
+{
+    for(int i = 0; i < STFT_MAX_BATCH; i++)
+        m_plans[i] = NULL;
+    setWindow(Hann);
+    reset();
+}
+
+template<typename Real>
+Stft<Real>::~Stft()
+{
+    release();
+}
+
+template<typename Real>
+void Stft<Real>::release()
+{
+    for(int i = 0; i < STFT_MAX_BATCH; i++) {
+        FftCache<Real>::instance().release(m_plans[i]);
+        m_plans[i] = NULL;
+    }
+    m_last = NULL;
+}
+
+template<typename Real>
+void Stft<Real>::setSize(quint32 size)
+{
+    if(size == m_size)
+        return;
+    release();
+    m_size = size;
+    tabulate(m_window, m_size, m_table);
+    setHop(m_hop);
+    reset();
+}
+
+// Periodic windows, the right kind for overlapping frames.
+template<typename Real>
+void Stft<Real>::tabulate(Window window, quint32 size, QVector<Real> & table)
+{
+    table.resize(size);
+    const double N = size;
+    double sum = 0;
+    for(quint32 n = 0; n < size; n++) {
+        const double t = 2*M_PI*n/N;
+        double w;
+        switch(window) {
+        case Hann:
+            w = 0.5 - 0.5*qCos(t);
+            break;
+        case BlackmanHarris:
+            w = 0.35875 - 0.48829*qCos(t) + 0.14128*qCos(2*t) - 0.01168*qCos(3*t);
+            break;
+        default: {
+            const double r = 2.0*n/N - 1.0;
+            w = besselI0(STFT_KAISER_BETA * qSqrt(qMax(0.0, 1.0 - r*r))) / besselI0(STFT_KAISER_BETA);
+            break;
+        }
+        }
+        table[n] = (Real) w;
+        sum += w;
+    }
+    for(quint32 n = 0; n < size; n++)
+        table[n] *= (Real) (N / sum);
+}
+
+template<typename Real>
+void Stft<Real>::setWindow(Window window)
+{
+    if(window == m_window || window < 0 || window >= WindowCount)
+        return;
+    m_window = window;
+    tabulate(window, m_size, m_table);
+}
+
+template<typename Real>
+void Stft<Real>::setHop(quint32 hop)
+{
+    m_hop = qBound(m_size / STFT_MAX_BATCH, hop, m_size);
+    m_pending = qMin(m_pending, m_hop - 1);
+}
+
+template<typename Real>
+void Stft<Real>::reset()
+{
+    // a window's worth of silence, so the first windows are complete
+    m_history.fill(0, m_size);
+    m_pending = 0;
+}
+
+// One plan per batch size, held from first use until the size changes.
+template<typename Real>
+FftPlan<Real> * Stft<Real>::batchPlan(int count)
+{
+    FftPlan<Real> *& p = m_plans[count - 1];
+    if(p == NULL)
+        p = FftCache<Real>::instance().acquire(FftPlan<Real>::RealToComplex, m_size, count, FftCache<Real>::Quick);
+    return p;
+}
+
+template<typename Real>
+int Stft<Real>::push(const scope_real * x, quint32 len)
+{
+    if(len > m_size) {
+        x += len - m_size;
+        len = m_size;
+    }
+    // keep a window plus the new samples
+    const int keep = m_size;
+    if(m_history.size() > keep)
+        m_history.remove(0, m_history.size() - keep);
+    const int at = m_history.size();
+    m_history.resize(at + len);
+    memcpy(m_history.data() + at, x, len * sizeof(scope_real));
+
+    m_pending += len;
+    int count = m_pending / m_hop;
+    m_pending %= m_hop;
+    if(count == 0)
+        return 0;
+    count = qMin(count, STFT_MAX_BATCH);
+
+    FftPlan<Real> * plan = batchPlan(count);
+    // window i ends (count-1-i) hops before the newest complete one
+    const scope_real * newest = m_history.constData() + m_history.size() - m_pending - m_size;
+    for(int i = 0; i < count; i++) {
+        const scope_real * s = newest - (size_t) (count - 1 - i) * m_hop;
+        Real * b = plan->real + (size_t) i * m_size;
+        for(quint32 n = 0; n < m_size; n++)
+            b[n] = (Real) s[n] * m_table[n];
+    }
+    plan->execute();
+    m_last = plan;
+    return count;
+}
+
+template class Stft<scope_real>;
@@ -0,0 +1,79 @@
+//
+//  stft.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef stft_hpp
+#define stft_hpp
+
+#include <QtGlobal>
+#include <QVector>
+#include <complex>
+#include "fft_cache.hpp"
+
+// most spectra one push() returns; older ones in the same push are dropped
+#define STFT_MAX_BATCH 8
+// Kaiser window shape; about 90 dB of sidelobe suppression
+#define STFT_KAISER_BETA 8.6
+
+// Short-time Fourier transform of a sample stream: windows of `size`
+// samples every hop() samples, independent of how the stream arrives.
+// The window table is built once per setWindow() or setSize(), and all
+// spectra that one push() completes run through one batched r2c plan
+// from FftCache.
+//
+// Windows are scaled to unit coherent gain, so a full-scale sinusoid
+// peaks at size/2 whichever window is chosen.
+//
+// Owned by the thread running the scope's DSP.
+template<typename Real>
+class Stft {
+public:
+    typedef std::complex<Real> complex;
+    enum Window {Hann, BlackmanHarris, Kaiser, WindowCount};
+    static const char * windowName(int window);
+    // `size` points of a periodic window at unit coherent gain
+    static void tabulate(Window window, quint32 size, QVector<Real> & table);
+
+    explicit Stft(quint32 size);
+    ~Stft();
+
+    void setWindow(Window window);
+    Window window() const {return m_window;}
+    // clamped to [size/STFT_MAX_BATCH, size]
+    void setHop(quint32 hop);
+    quint32 hop() const {return m_hop;}
+    // Starts over with `size`-point windows; the hop is clamped again.
+    void setSize(quint32 size);
+    quint32 size() const {return m_size;}
+    quint32 bins() const {return m_size/2 + 1;}
+
+    // Forgets the stream, as if it had been silent.
+    void reset();
+
+    // Appends the next `len` (at most size()) samples and transforms
+    // every window they complete. Returns how many spectra are ready.
+    int push(const scope_real * x, quint32 len);
+    // bins() bins of the i-th spectrum of the last push(), oldest first
+    const complex * spectrum(int i) const {return m_last->out + (size_t) i * bins();}
+
+private:
+    Stft(const Stft &) = delete;
+    Stft & operator=(const Stft &) = delete;
+
+    FftPlan<Real> * batchPlan(int count);
+    void release();
+
+    quint32 m_size;
+    quint32 m_hop;
+    Window m_window = WindowCount;
+    QVector<Real> m_table;
+    QVector<scope_real> m_history;  // newest sample last
+    quint32 m_pending = 0;          // samples since the last window ended
+    FftPlan<Real> * m_plans[STFT_MAX_BATCH];   // by batch size, as needed
+    FftPlan<Real> * m_last = NULL;
+};
+
+#endif /* stft_hpp */
@@ -0,0 +1,312 @@
+//
+//  trigger.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <algorithm>
+#include "trigger.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TRIGGER_X86 1
+#endif
+
+namespace {
+
+// First i in [from, len) with s[i] >= t, or with s[i] < t when searching
+// below; len if there is none.
+template<bool Above, typename T>
+quint32 findScalar(const T * s, quint32 from, quint32 len, T t)
+{
+    for(quint32 i = from; i < len; i++)
+        if(Above ? s[i] >= t : s[i] < t)
+            return i;
+    return len;
+}
+
+#ifdef TRIGGER_X86
+
+#ifdef __SSE2__
+template<bool Above>
+quint32 findSse2(const float * s, quint32 from, quint32 len, float t)
+{
+    const __m128 k = _mm_set1_ps(t);
+    quint32 i = from;
+    for(; i + 4 <= len; i += 4) {
+        const __m128 v = _mm_loadu_ps(s + i);
+        const int m = _mm_movemask_ps(Above ? _mm_cmpge_ps(v, k) : _mm_cmplt_ps(v, k));
+        if(m != 0)
+            return i + __builtin_ctz(m);
+    }
+    return findScalar<Above>(s, i, len, t);
+}
+
+template<bool Above>
+quint32 findSse2(const double * s, quint32 from, quint32 len, double t)
+{
+    const __m128d k = _mm_set1_pd(t);
+    quint32 i = from;
+    for(; i + 2 <= len; i += 2) {
+        const __m128d v = _mm_loadu_pd(s + i);
+        const int m = _mm_movemask_pd(Above ? _mm_cmpge_pd(v, k) : _mm_cmplt_pd(v, k));
+        if(m != 0)
+            return i + __builtin_ctz(m);
+    }
+    return findScalar<Above>(s, i, len, t);
+}
+#endif
+
+template<bool Above>
+__attribute__((target("avx2")))
+quint32 findAvx2(const float * s, quint32 from, quint32 len, float t)
+{
+    const __m256 k = _mm256_set1_ps(t);
+    quint32 i = from;
+    for(; i + 8 <= len; i += 8) {
+        const __m256 v = _mm256_loadu_ps(s + i);
+        const int m = _mm256_movemask_ps(_mm256_cmp_ps(v, k, Above ? _CMP_GE_OQ : _CMP_LT_OQ));
+        if(m != 0)
+            return i + __builtin_ctz(m);
+    }
+    return findScalar<Above>(s, i, len, t);
+}
+
+template<bool Above>
+__attribute__((target("avx2")))
+quint32 findAvx2(const double * s, quint32 from, quint32 len, double t)
+{
+    const __m256d k = _mm256_set1_pd(t);
+    quint32 i = from;
+    for(; i + 4 <= len; i += 4) {
+        const __m256d v = _mm256_loadu_pd(s + i);
+        const int m = _mm256_movemask_pd(_mm256_cmp_pd(v, k, Above ? _CMP_GE_OQ : _CMP_LT_OQ));
+        if(m != 0)
+            return i + __builtin_ctz(m);
+    }
+    return findScalar<Above>(s, i, len, t);
+}
+
+#endif /* TRIGGER_X86 */
+
+typedef quint32 (*FindKernel)(const scope_real *, quint32, quint32, scope_real);
+
+struct Kernels {
+    FindKernel above;
+    FindKernel below;
+};
+
+Kernels selectKernels()
+{
+#ifdef TRIGGER_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return Kernels{findAvx2<true>, findAvx2<false>};
+#ifdef __SSE2__
+    return Kernels{findSse2<true>, findSse2<false>};
+#endif
+#endif
+    return Kernels{findScalar<true, scope_real>, findScalar<false, scope_real>};
+}
+
+const Kernels kernels = selectKernels();
+
+} // namespace
+
+template<typename Real>
+const char * Trigger<Real>::edgeName(int edge)
+{
+    static const char * names[EdgeCount] = {"Rising", "Falling", "Either"};
+    return names[edge];
+}
+
+template<typename Real>
+const char * Trigger<Real>::modeName(int mode)
+{
+    static const char * names[ModeCount] = {"Auto", "Normal", "Single"};
+    return names[mode];
+}
+
+template<typename Real>
+Trigger<Real>::Trigger(quint32 length)
+{
+    setLength(length);
+}
+
+template<typename Real>
+void Trigger<Real>::setSettings(const Settings & settings)
+{
+    Settings s = settings;
+    s.pretrigger = qMin(s.pretrigger, m_length - 1);
+    if(s.edge != m_settings.edge || s.source != m_settings.source
+       || s.level != m_settings.level || s.hysteresis != m_settings.hysteresis)
+        m_armed[0] = m_armed[1] = false;
+    if(s.mode != Single)
+        m_held = false;
+    m_settings = s;
+}
+
+template<typename Real>
+void Trigger<Real>::setLength(quint32 length)
+{
+    length = qMax(1U, length);
+    if(length == m_length)
+        return;
+    m_length = length;
+    m_capacity = 1;
+    while(m_capacity < 3 * m_length)
+        m_capacity *= 2;
+    m_ring.fill(complex(0), 2 * m_capacity);
+    m_source.resize(m_length);
+    m_settings.pretrigger = qMin(m_settings.pretrigger, m_length - 1);
+    m_held = false;
+    reset();
+}
+
+template<typename Real>
+void Trigger<Real>::reset()
+{
+    m_written = m_pushed = 0;
+    m_armed[0] = m_armed[1] = false;
+    m_holdoffEnd = 0;
+    m_pending.clear();
+    m_complete = -1;
+    m_fresh = false;
+    // windows starting before the first sample read silence
+    complex * r = m_ring.data();
+    std::fill(r + m_capacity - m_length, r + m_capacity, complex(0));
+    std::fill(r + 2*m_capacity - m_length, r + 2*m_capacity, complex(0));
+}
+
+template<typename Real>
+void Trigger<Real>::push(const complex * z, quint32 len)
+{
+    if(m_held)
+        return;
+    if(len > m_length) {
+        z += len - m_length;
+        len = m_length;
+    }
+    Real * s = m_source.data();
+    if(m_settings.source == Power) {
+        for(quint32 n = 0; n < len; n++)
+            s[n] = std::norm(z[n]);
+    } else {
+        for(quint32 n = 0; n < len; n++)
+            s[n] = z[n].real();
+    }
+    scan(len);
+    append(z, len);
+    m_pushed = m_written;
+    complete();
+}
+
+template<typename Real>
+void Trigger<Real>::pad(quint32 len)
+{
+    if(m_held)
+        return;
+    complex * r = m_ring.data();
+    for(quint32 n = 0; n < qMin(len, m_length); n++) {
+        const quint32 i = (m_written + n) & (m_capacity - 1);
+        r[i] = r[i + m_capacity] = 0;
+    }
+    m_written += qMin(len, m_length);
+    complete();
+}
+
+template<typename Real>
+void Trigger<Real>::append(const complex * z, quint32 len)
+{
+    complex * r = m_ring.data();
+    for(quint32 n = 0; n < len; n++) {
+        const quint32 i = (m_written + n) & (m_capacity - 1);
+        r[i] = r[i + m_capacity] = z[n];
+    }
+    m_written += len;
+}
+
+// Each edge alternates between looking for its arming crossing and its
+// firing one; both are threshold searches over the source.
+template<typename Real>
+quint32 Trigger<Real>::find(int edge, quint32 from, quint32 len) const
+{
+    const Real * s = m_source.constData();
+    const Settings & p = m_settings;
+    if(edge == Rising)
+        return m_armed[Rising] ? kernels.above(s, from, len, p.level)
+                               : kernels.below(s, from, len, p.level - p.hysteresis);
+    return m_armed[Falling] ? kernels.below(s, from, len, p.level)
+                            : kernels.above(s, from, len, p.level + p.hysteresis);
+}
+
+// Steps from one crossing to the next rather than sample by sample. A
+// trigger disarms both edges, and arming only resumes after the holdoff.
+template<typename Real>
+void Trigger<Real>::scan(quint32 len)
+{
+    const bool watch[2] = {m_settings.edge != Falling, m_settings.edge != Rising};
+    quint32 i = (quint32) qBound((qint64) 0, m_holdoffEnd - m_written, (qint64) len);
+    while(i < len) {
+        quint32 next[2] = {len, len};
+        for(int e = 0; e < 2; e++)
+            if(watch[e])
+                next[e] = find(e, i, len);
+        const quint32 n = qMin(next[0], next[1]);
+        if(n == len)
+            break;
+        bool fired = false;
+        for(int e = 0; e < 2; e++) {
+            if(!watch[e] || next[e] != n)
+                continue;
+            if(m_armed[e])
+                fired = true;
+            else
+                m_armed[e] = true;
+        }
+        if(!fired) {
+            i = n + 1;
+            continue;
+        }
+        const qint64 t = m_written + n;
+        m_pending.append(t);
+        m_armed[0] = m_armed[1] = false;
+        m_holdoffEnd = t + 1 + m_settings.holdoff;
+        i = (quint32) qMin(m_holdoffEnd - m_written, (qint64) len);
+    }
+}
+
+// Windows complete in trigger order, as they all need the same number of
+// samples after the trigger.
+template<typename Real>
+void Trigger<Real>::complete()
+{
+    const qint64 due = m_written - (m_length - m_settings.pretrigger);
+    while(!m_pending.isEmpty() && m_pending.first() <= due) {
+        m_complete = m_pending.takeFirst();
+        m_fresh = true;
+    }
+}
+
+template<typename Real>
+const typename Trigger<Real>::complex * Trigger<Real>::window()
+{
+    if(m_held)
+        return at(m_start);
+    if(m_fresh) {
+        m_fresh = false;
+        m_start = m_complete - m_settings.pretrigger;
+        m_triggerIndex = m_settings.pretrigger;
+        m_held = m_settings.mode == Single;
+        return at(m_start);
+    }
+    // Auto waits a window's length after a trigger before free-running
+    if(m_settings.mode != Auto || (m_complete >= 0 && m_pushed - m_complete < m_length))
+        return NULL;
+    m_start = m_pushed - m_length;
+    m_triggerIndex = -1;
+    return at(m_start);
+}
+
+template class Trigger<scope_real>;
@@ -0,0 +1,113 @@
+//
+//  trigger.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef trigger_hpp
+#define trigger_hpp
+
+#include <QtGlobal>
+#include <QVector>
+#include <QList>
+#include <complex>
+#include "scope_real.hpp"
+
+// Edge trigger over a stream of complex samples, watching either their
+// real part or their power (squared magnitude). An edge has to cross
+// back past the level by the hysteresis before it can fire again, and
+// after firing the trigger stays disarmed for the holdoff.
+//
+// The last samples are kept in a history, so a triggered window can
+// start `pretrigger` samples before the event and triggers are found
+// across push() boundaries. A window is shown once all `length` samples
+// of it have arrived.
+//
+// Owned by the thread running the scope's DSP.
+template<typename Real>
+class Trigger {
+public:
+    typedef std::complex<Real> complex;
+
+    enum Edge {Rising, Falling, Either, EdgeCount};
+    // Auto free-runs when nothing has triggered for a window's length,
+    // Normal shows only triggered windows, Single holds the first one
+    // until rearm().
+    enum Mode {Auto, Normal, Single, ModeCount};
+    enum Source {RealPart, Power};
+    static const char * edgeName(int edge);
+    static const char * modeName(int mode);
+
+    // Levels are in the units of the source, so for Power the square of
+    // a magnitude; hysteresis is below the level for a rising edge and
+    // above it for a falling one.
+    struct Settings {
+        int edge = Rising;
+        int mode = Normal;
+        int source = RealPart;
+        Real level = 0;
+        Real hysteresis = 0;
+        quint32 holdoff = 0;        // samples
+        quint32 pretrigger = 0;     // samples, clamped below the length
+    };
+
+    explicit Trigger(quint32 length = 1);
+
+    // Keeps the history; a new mode or edge disarms, and leaving Single
+    // releases a held window.
+    void setSettings(const Settings & settings);
+    const Settings & settings() const {return m_settings;}
+    // Starts over with `length`-sample windows.
+    void setLength(quint32 length);
+    quint32 length() const {return m_length;}
+
+    // Forgets the history and any pending triggers, as if fed silence.
+    // A held single shot stays held.
+    void reset();
+    // Lets a Single trigger fire again.
+    void rearm() {m_held = false;}
+    bool held() const {return m_held;}
+
+    // Appends the next `len` (at most length()) samples and looks for
+    // triggers in them.
+    void push(const complex * z, quint32 len);
+    // Appends `len` (at most length()) samples of silence without looking
+    // at them, completing windows that reach past the end of a block.
+    void pad(quint32 len);
+
+    // length() samples to show after the last push(), or NULL if there
+    // is nothing new. Each completed trigger is handed out once, except
+    // that a held single shot keeps coming back.
+    const complex * window();
+    // Where the trigger is in the last window(), -1 if it free-ran.
+    int triggerIndex() const {return m_triggerIndex;}
+    // Where the last window() starts, in samples since reset().
+    qint64 windowStart() const {return m_start;}
+
+private:
+    void append(const complex * z, quint32 len);
+    void scan(quint32 len);
+    quint32 find(int edge, quint32 from, quint32 len) const;
+    void complete();
+    const complex * at(qint64 pos) const {return m_ring.constData() + (pos & (m_capacity - 1));}
+
+    Settings m_settings;
+    quint32 m_length = 0;
+    quint32 m_capacity = 0;         // a power of two, at least 3*length
+    QVector<complex> m_ring;        // [capacity], mirrored
+    QVector<Real> m_source;         // real part or power of the last push
+
+    qint64 m_written = 0;           // samples appended since reset()
+    qint64 m_pushed = 0;            // of those, the ones that weren't pad()
+    bool m_armed[2] = {false, false};   // rising, falling
+    qint64 m_holdoffEnd = 0;
+    QList<qint64> m_pending;        // triggers still waiting on samples
+    qint64 m_complete = -1;         // the newest one with its window in
+    bool m_fresh = false;           // m_complete not yet shown
+    bool m_held = false;
+    qint64 m_start = 0;             // of the last window()
+    int m_triggerIndex = -1;
+};
+
+#endif /* trigger_hpp */
@@ -0,0 +1,70 @@
+//
+//  triple_buffer.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef triple_buffer_hpp
+#define triple_buffer_hpp
+
+#include <QAtomicInteger>
+
+// Lock-free hand-off of the latest value from one writer thread to one
+// reader thread. The writer fills back() and publishes it; the reader
+// calls update() and then owns front() until its next update(). Neither
+// side ever waits, and the reader never sees a partially written slot.
+template<class T>
+class TripleBuffer {
+public:
+    TripleBuffer() : m_ready(1) {}
+    explicit TripleBuffer(const T & init) : m_ready(1) {
+        m_slots[0] = m_slots[1] = m_slots[2] = init;
+    }
+
+    // writer; publish() returns true if the value it replaces was never
+    // picked up by the reader
+    T & back() {return m_slots[m_back];}
+    bool publish() {
+        int old = m_ready.fetchAndStoreOrdered(m_back | FRESH);
+        m_back = old & INDEX;
+        return old & FRESH;
+    }
+
+    // reader
+    bool update() {
+        if(!(m_ready.loadAcquire() & FRESH))
+            return false;
+        m_front = m_ready.fetchAndStoreOrdered(m_front) & INDEX;
+        return true;
+    }
+    T & front() {return m_slots[m_front];}
+
+private:
+    enum {INDEX = 3, FRESH = 4};
+    T m_slots[3];
+    int m_back = 0;
+    QAtomicInteger<int> m_ready;
+    int m_front = 2;
+};
+
+// Latest-value mailbox for parameter updates: the GUI posts, the worker
+// fetches at its next frame boundary.
+template<class T>
+class Mailbox {
+public:
+    void post(const T & value) {
+        m_buf.back() = value;
+        m_buf.publish();
+    }
+    bool fetch(T & value) {
+        if(!m_buf.update())
+            return false;
+        value = m_buf.front();
+        return true;
+    }
+private:
+    TripleBuffer<T> m_buf;
+};
+
+#endif /* triple_buffer_hpp */
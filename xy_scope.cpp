@@ -0,0 +1,103 @@
+//
+//  xy_scope.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <QApplication>
+#include <QPainter>
+#include <QWheelEvent>
+#include <qmath.h>
+#include "xy_scope.hpp"
+
+XYScope::XYScope(QWidget * parent) : RasterImage(parent)
+{
+}
+
+XYScope::~XYScope()
+{
+    quit();
+}
+
+void XYScope::applyParams()
+{
+    m_paramBox.fetch(m_params);
+}
+
+void XYScope::refreshImpl()
+{
+    const Params & p = m_params;
+    const scope_real * xs = data(0);
+    const scope_real * ys = data(channels() > 1 ? 1 : 0);
+
+    const int N = len();
+    const int first = N - qMin(hop(), len());
+    const int maxX = width();
+    const int maxY = height();
+    const qreal half = qMin(maxX, maxY) / 2 * p.scale;
+
+    m_raster.resize(maxX, maxY);
+    m_raster.begin();
+    for(int n = first; n < N; n++) {
+        int x = qFloor(xs[n]*half + maxX/2);
+        int y = qFloor(-ys[n]*half + maxY/2);
+        if(x >= 0 && x < maxX && y >= 0 && y < maxY) {
+            double incr = (qreal) (n - first + 1) / (qreal) (N - first);
+            m_raster.add(x, y, qRound(incr*p.redDecay*255.0), qRound(incr*p.blueDecay*255.0));
+        }
+    }
+
+    // only what is still fading needs the fade, or a repaint
+    const int arm = 256/p.greenDecay;
+    const QRect live = m_fade.push(m_raster.bounds(arm), size());
+    QPainter imgPainter(this);
+    QColor color;
+    color.setRgbF(0.0, 0.0, 0.0);
+    color.setAlphaF(.05);
+    imgPainter.setBrush(color);
+    imgPainter.setPen(Qt::NoPen);
+    imgPainter.drawRect(live);
+    imgPainter.end();
+    m_raster.render(*this, arm, p.greenDecay);
+    setDirty(live);
+    stage(StageClock::Raster);
+}
+
+void XYScope::wheelEvent(QWheelEvent *ev)
+{
+    if((ev->angleDelta().x() != 0 || ev->angleDelta().y() != 0)) {
+        
+        if(QApplication::queryKeyboardModifiers().testFlag(Qt::ShiftModifier)) {
+            if(ev->angleDelta().x() > 0)
+                m_ui.greenDecay += 4;
+            else if(ev->angleDelta().x() < 0)
+                m_ui.greenDecay -= 4;
+            m_ui.greenDecay = qMax(1, qMin(128, m_ui.greenDecay));
+            setTitle(QString("[Scale: %1] [Green: %2]").arg( m_ui.scale).arg(m_ui.greenDecay));
+        } else if(
+                  QApplication::queryKeyboardModifiers().testFlag(Qt::AltModifier)) {
+            if(ev->angleDelta().x() > 0)
+                m_ui.blueDecay += .01;
+            else if(ev->angleDelta().x() < 0)
+                m_ui.blueDecay -= .01;
+            m_ui.blueDecay = qMax(0.001, qMin(1.0, m_ui.blueDecay));
+            
+            if(ev->angleDelta().y() > 0)
+                m_ui.redDecay += .01;
+            else if(ev->angleDelta().y() < 0)
+                m_ui.redDecay -= .01;
+            m_ui.redDecay = qMax(0.001, qMin(1.0, m_ui.redDecay));
+            
+            setTitle(QString("[Red: %1] [Blue: %2]").arg( m_ui.redDecay).arg(m_ui.blueDecay));
+        } else {
+            if(ev->angleDelta().y() > 0) // up Wheel
+                m_ui.scale *= 1.05;
+            else if(ev->angleDelta().y() < 0) //down Wheel
+                m_ui.scale /= 1.05;
+            m_ui.scale = qMax(0.001, m_ui.scale);
+            setTitle(QString("[Scale: %1]").arg(m_ui.scale));
+        }
+        m_paramBox.post(m_ui);
+    }
+}
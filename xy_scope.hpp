@@ -0,0 +1,45 @@
+//
+//  xy_scope.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef xy_scope_hpp
+#define xy_scope_hpp
+
+#include "raster_image.hpp"
+#include "point_raster.hpp"
+
+// Classic X/Y (Lissajous) display: the first channel against the second,
+// sample by sample, with the analytic scope's phosphor look. Each frame
+// plots only the hop() samples new since the previous one. Mono input
+// plots against itself, i.e. along the diagonal.
+class XYScope : public RasterImage
+{
+public:
+    explicit XYScope(QWidget *parent);
+    ~XYScope();
+
+    quint32 historyFrames() const override {return TRACE_FADE_FRAMES;}
+
+protected:
+    void wheelEvent(QWheelEvent *ev) override;
+    void refreshImpl() override;
+    void applyParams() override;
+private:
+    struct Params {
+        qreal scale = 1.0;
+        qreal redDecay = .6667;
+        qreal blueDecay = .75;
+        int greenDecay = 4;
+    };
+    Params m_ui;        // edited on the GUI thread
+    Params m_params;    // in effect on the worker
+    Mailbox<Params> m_paramBox;
+
+    PointRaster m_raster;
+    FadeRegion m_fade{TRACE_FADE_FRAMES};
+};
+
+#endif /* xy_scope_hpp */
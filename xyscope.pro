@@ -1,12 +1,9 @@
-QMAKE_MACOSX_DEPLOYMENT_TARGET = 10.15
-QT += widgets multimedia
+QT += widgets multimedia network concurrent
 
 CONFIG += debug
-SOURCES = main.cpp raster_view.cpp analytic_scope.cpp spectrum_scope.cpp
-HEADERS = raster_view.hpp raster_image.hpp spectrum_scope.hpp analytic_scope.hpp
-
-LIBS += -L/usr/local/lib -lfftw3_omp -lm -lfftw3
-INCLUDEPATH += /usr/local/include
+SOURCES = main.cpp raster_view.cpp pcm_file.cpp offline_render.cpp frame_pacer.cpp capture_recorder.cpp sample_source.cpp jitter_buffer.cpp
+HEADERS = raster_view.hpp pcm_file.hpp offline_render.hpp frame_pacer.hpp capture_recorder.hpp sample_source.hpp jitter_buffer.hpp
+include(scopes.pri)
 
 # install
 target.path = .
@@ -0,0 +1,10 @@
+# Headless micro-benchmark of ingest() and each scope's refreshImpl():
+#   qmake -o Makefile.bench xyscope_bench.pro && make -f Makefile.bench
+#   ./xyscope_bench --help
+TARGET = xyscope_bench
+CONFIG += console
+CONFIG -= app_bundle
+OBJECTS_DIR = .bench
+MOC_DIR = .bench
+SOURCES = bench_main.cpp
+include(scopes.pri)
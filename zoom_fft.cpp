@@ -0,0 +1,163 @@
+//
+//  zoom_fft.cpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#include <cstring>
+#include <qmath.h>
+#include "zoom_fft.hpp"
+
+template<typename Real>
+ZoomFft<Real>::ZoomFft(quint32 size) : m_size(0), m_hop(size)
+{
+    setSize(size);
+    setWindow(Stft<Real>::Hann);
+    setBand(0, 1, 1);
+}
+
+template<typename Real>
+ZoomFft<Real>::~ZoomFft()
+{
+    FftCache<Real>::instance().release(m_plan);
+    FFTW<Real>::free(m_spectra);
+}
+
+// Spectra are written past the plan's own output with execute_dft(),
+// into a batch allocated, and so aligned, the same way.
+template<typename Real>
+void ZoomFft<Real>::setSize(quint32 size)
+{
+    if(size == m_size)
+        return;
+    FftCache<Real>::instance().release(m_plan);
+    FFTW<Real>::free(m_spectra);
+    m_size = size;
+    m_plan = FftCache<Real>::instance().acquire(FftPlan<Real>::Forward, m_size, 1, FftCache<Real>::Quick);
+    m_spectra = FFTW<Real>::alloc_complex((size_t) STFT_MAX_BATCH * m_size);
+    if(m_window >= 0)
+        Stft<Real>::tabulate((typename Stft<Real>::Window) m_window, m_size, m_table);
+    setHop(m_hop);
+    if(m_decimation != 0)
+        reset();
+}
+
+template<typename Real>
+void ZoomFft<Real>::setWindow(typename Stft<Real>::Window window)
+{
+    if(window == m_window)
+        return;
+    m_window = window;
+    Stft<Real>::tabulate(window, m_size, m_table);
+}
+
+template<typename Real>
+void ZoomFft<Real>::setHop(quint32 hop)
+{
+    m_hop = qBound(m_size / STFT_MAX_BATCH, hop, m_size);
+    m_pending = qMin(m_pending, m_hop - 1);
+}
+
+// The prototype low-pass is a Blackman-windowed sinc cutting off at the
+// decimated Nyquist rate, ZOOM_TAPS_PER_PHASE * decimation taps long,
+// split into its polyphase branches.
+template<typename Real>
+void ZoomFft<Real>::setBand(qreal center, quint32 decimation, qreal rate)
+{
+    quint32 D = 1;
+    while(D * 2 <= qMin(decimation, (quint32) ZOOM_MAX_DECIMATION))
+        D *= 2;
+    center = qBound(0.0, center, rate / 2);
+    if(center == m_center && D == m_decimation && rate == m_rate)
+        return;
+    m_center = center;
+    m_decimation = D;
+    m_rate = rate;
+    m_step = std::polar(1.0, -2*M_PI*center/rate);
+
+    m_taps = D == 1 ? 1 : ZOOM_TAPS_PER_PHASE;
+    const int L = m_taps * D;
+    QVector<double> h(L);
+    double sum = 0;
+    for(int k = 0; k < L; k++) {
+        const double t = k - (L - 1) / 2.0;
+        const double x = M_PI * t / D;
+        const double w = L == 1 ? 1 : 0.42 - 0.5*qCos(2*M_PI*k/(L - 1)) + 0.08*qCos(4*M_PI*k/(L - 1));
+        h[k] = w * (x == 0 ? 1 : qSin(x) / x);
+        sum += h[k];
+    }
+    m_coef.resize(L);
+    for(quint32 p = 0; p < D; p++)
+        for(int q = 0; q < m_taps; q++)
+            m_coef[p*m_taps + q] = (Real) (h[q*D + p] / sum);
+    reset();
+}
+
+template<typename Real>
+void ZoomFft<Real>::reset()
+{
+    m_phasor = 1;
+    m_lines.fill(complex(0), m_decimation * 2 * m_taps);
+    m_branch = 0;
+    m_outputs = 0;
+    m_history.fill(complex(0), m_size);
+    m_pending = 0;
+}
+
+template<typename Real>
+int ZoomFft<Real>::push(const scope_real * x, quint32 len)
+{
+    if(len > m_size) {
+        x += len - m_size;
+        len = m_size;
+    }
+    if(m_history.size() > (int) m_size)
+        m_history.remove(0, m_history.size() - m_size);
+    m_ends.resize(0);
+
+    const int Q = m_taps;
+    for(quint32 n = 0; n < len; n++) {
+        const std::complex<double> v = m_phasor * (double) x[n];
+        m_phasor *= m_step;
+
+        // Samples go round the branches from the last down to 0, and
+        // each one that reaches branch 0 completes an output.
+        const int slot = Q - 1 - (int) (m_outputs % Q);
+        complex * line = m_lines.data() + (size_t) m_branch * 2 * Q;
+        line[slot] = line[slot + Q] = complex((Real) v.real(), (Real) v.imag());
+        if(m_branch == 0) {
+            complex acc = 0;
+            for(quint32 p = 0; p < m_decimation; p++) {
+                const Real * h = m_coef.constData() + p*Q;
+                const complex * l = m_lines.constData() + (size_t) p*2*Q + slot;
+                for(int q = 0; q < Q; q++)
+                    acc += h[q] * l[q];
+            }
+            m_history.append(acc);
+            m_outputs++;
+            m_branch = m_decimation - 1;
+        } else {
+            m_branch--;
+        }
+
+        if(++m_pending == m_hop) {
+            m_pending = 0;
+            m_ends.append(m_history.size());
+            if(m_ends.size() > STFT_MAX_BATCH)
+                m_ends.remove(0);
+        }
+    }
+    // keep rounding from creeping into the mixer's amplitude
+    m_phasor /= std::abs(m_phasor);
+
+    for(int i = 0; i < m_ends.size(); i++) {
+        const complex * s = m_history.constData() + m_ends[i] - m_size;
+        for(quint32 n = 0; n < m_size; n++)
+            m_plan->in[n] = s[n] * m_table[n];
+        FFTW<Real>::execute_dft(m_plan->plan, m_plan->in, m_spectra + (size_t) i * m_size);
+    }
+    return m_ends.size();
+}
+
+template class ZoomFft<scope_real>;
@@ -0,0 +1,89 @@
+//
+//  zoom_fft.hpp
+//  xyscope
+//
+//  Created by )\( on 10/17/26.
+//
+
+#ifndef zoom_fft_hpp
+#define zoom_fft_hpp
+
+#include <QtGlobal>
+#include <QVector>
+#include <complex>
+#include "stft.hpp"
+
+// anti-alias FIR length per polyphase branch
+#define ZOOM_TAPS_PER_PHASE 32
+#define ZOOM_MAX_DECIMATION 256
+
+// Band-selective spectra of a sample stream: mixed down so `center` Hz
+// lands on DC, low-passed and decimated by a polyphase FIR, then windowed
+// and transformed at `size` points. Bin k of a spectrum is center +
+// k*rate/(decimation*size) Hz, with negative offsets in the upper half,
+// so a band `decimation` times narrower than the full one is resolved
+// `decimation` times finer for the cost of one FFT of the same size.
+//
+// Spectra come every hop input samples, as from Stft, and share its
+// windows and level: a full-scale sinusoid in the band peaks at size/2.
+//
+// Owned by the thread running the scope's DSP.
+template<typename Real>
+class ZoomFft {
+public:
+    typedef std::complex<Real> complex;
+
+    explicit ZoomFft(quint32 size);
+    ~ZoomFft();
+
+    // Rebuilds the mixer and filter and reset()s when either changes.
+    // `decimation` is rounded down to a power of two.
+    void setBand(qreal center, quint32 decimation, qreal rate);
+    qreal center() const {return m_center;}
+    quint32 decimation() const {return m_decimation;}
+    void setWindow(typename Stft<Real>::Window window);
+    // clamped to [size/STFT_MAX_BATCH, size], in input samples
+    void setHop(quint32 hop);
+    // Starts over with `size`-point spectra.
+    void setSize(quint32 size);
+    quint32 size() const {return m_size;}
+
+    void reset();
+
+    // Appends the next `len` (at most size()) input samples. Returns how
+    // many spectra are ready.
+    int push(const scope_real * x, quint32 len);
+    // size() bins of the i-th spectrum of the last push(), oldest first
+    const complex * spectrum(int i) const {return m_spectra + (size_t) i * m_size;}
+
+private:
+    ZoomFft(const ZoomFft &) = delete;
+    ZoomFft & operator=(const ZoomFft &) = delete;
+
+    quint32 m_size;
+    quint32 m_hop;
+    qreal m_center = -1;
+    qreal m_rate = 0;
+    quint32 m_decimation = 0;
+    int m_window = -1;
+    QVector<Real> m_table;
+
+    // mixer
+    std::complex<double> m_phasor, m_step;
+    // polyphase decimator: branch p holds every decimation-th sample, and
+    // its taps are every decimation-th tap of the prototype low-pass
+    int m_taps = 0;                     // per branch
+    QVector<Real> m_coef;               // [branch][tap]
+    QVector<complex> m_lines;           // [branch][2*taps], mirrored
+    quint32 m_branch = 0;               // the next sample's
+    quint64 m_outputs = 0;
+
+    QVector<complex> m_history;         // decimated, newest last
+    quint32 m_pending = 0;              // input samples since the last spectrum
+    QVector<int> m_ends;                // history positions of this push's spectra
+
+    FftPlan<Real> * m_plan = NULL;      // from FftCache; its input is the windowed block
+    complex * m_spectra = NULL;
+};
+
+#endif /* zoom_fft_hpp */